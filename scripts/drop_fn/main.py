@@ -15,12 +15,31 @@ delays = []
 cur_ys = []
 cur_pts = []
 
-container = av.open(video_path)
-stream = container.streams.video[0]
 
-for frame in container.decode(stream):
-    img = frame.to_ndarray(format='bgr24')
-    pts_time = float(frame.pts * stream.time_base) * 1000
+def read_video(path):
+    container = av.open(path)
+    stream = container.streams.video[0]
+    for frame in container.decode(stream):
+        yield frame.to_ndarray(format='bgr24'), float(frame.pts * stream.time_base) * 1000
+
+
+def read_recording(path):
+    # layout written by psh::FrameRecorder, the lanes below are only recorded
+    # with the track area or the whole display as record region
+    header = np.fromfile(path, dtype=np.int32, count=16)
+    capacity, count, width, height, rx, ry, rw, rh = header[3:11]
+    times = np.memmap(path, dtype=np.int64, mode='r', offset=64, shape=(count,))
+    frames = np.memmap(path, dtype=np.uint8, mode='r', offset=64 + 8 * capacity,
+                       shape=(count, rh, rw, 3))
+    for i in range(count):
+        img = np.zeros((height, width, 3), dtype=np.uint8)
+        img[ry:ry + rh, rx:rx + rw] = frames[i]
+        yield img, float(times[i] - times[0])
+
+
+frames = read_recording(video_path) if video_path.endswith('.pshrec') else read_video(video_path)
+
+for img, pts_time in frames:
     mask = cv2.inRange(img[0:720, 1046:1263], lb, ub)
     contours, _ = cv2.findContours(mask, cv2.RETR_EXTERNAL, cv2.CHAIN_APPROX_NONE)
 
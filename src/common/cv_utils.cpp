@@ -1,5 +1,8 @@
 #include "common/cv_utils.h"
 
+#include <algorithm>
+#include <cstring>
+
 namespace psh {
 
 bool ColorSimilar(const cv::Vec3b& c1, const cv::Vec3b& c2, int delta) {
@@ -31,4 +34,47 @@ double CalcSimilarity(const cv::Mat& img1, const cv::Mat& img2) {
     return psnr;
 }
 
-} // namespace psh
\ No newline at end of file
+uint64_t CalcFingerprint(const cv::Mat& img,
+                         const std::vector<cv::Rect>& regions) {
+    // Every pixel of every kRowStride-th row is hashed. A change is missed
+    // only when all its rows fall between the sampled ones: one row high
+    // changes are missed 3 times out of 4, three rows high ones once out of
+    // 4 and anything kRowStride rows or higher is always seen. A note or a
+    // hold edge on the check area spans far more rows than that.
+    constexpr int kRowStride = 4;
+    constexpr uint64_t kFnvOffset = 14695981039346656037ULL;
+    constexpr uint64_t kFnvPrime = 1099511628211ULL;
+    CV_Assert(img.empty() || img.type() == CV_8UC3);
+
+    uint64_t hash = kFnvOffset;
+    auto hash_region = [&](const cv::Rect& region) {
+        cv::Rect rect = region & cv::Rect(0, 0, img.cols, img.rows);
+        size_t row_bytes = 3 * static_cast<size_t>(rect.width);
+        // the middle row of each stride
+        for (int y = rect.y + std::min(kRowStride, rect.height) / 2;
+             y < rect.y + rect.height; y += kRowStride) {
+            const uchar* row = img.ptr<uchar>(y) + 3 * rect.x;
+            size_t i = 0;
+            for (; i + sizeof(uint64_t) <= row_bytes; i += sizeof(uint64_t)) {
+                uint64_t word;
+                std::memcpy(&word, row + i, sizeof(word));
+                hash ^= word;
+                hash *= kFnvPrime;
+            }
+            for (; i < row_bytes; ++i) {
+                hash ^= row[i];
+                hash *= kFnvPrime;
+            }
+        }
+    };
+    if (regions.empty()) {
+        hash_region({0, 0, img.cols, img.rows});
+    } else {
+        for (const auto& region : regions) {
+            hash_region(region);
+        }
+    }
+    return hash;
+}
+
+} // namespace psh
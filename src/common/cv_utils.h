@@ -3,6 +3,9 @@
 #ifndef PSH_COMMON_CV_UTILS_H_
 #define PSH_COMMON_CV_UTILS_H_
 
+#include <cstdint>
+#include <vector>
+
 #include <opencv2/opencv.hpp>
 
 namespace psh {
@@ -13,6 +16,11 @@ cv::Mat CreateMask(const cv::Mat& img, const cv::Scalar& color, int delta);
 
 double CalcSimilarity(const cv::Mat& img1, const cv::Mat& img2);
 
+// Hash of every 4th pixel row inside each region, or the whole image when
+// regions is empty. Equal images always give equal fingerprints.
+uint64_t CalcFingerprint(const cv::Mat& img,
+                         const std::vector<cv::Rect>& regions = {});
+
 } // namespace psh
 
 #endif // !PSH_COMMON_CV_UTILS_H_
\ No newline at end of file
@@ -0,0 +1,215 @@
+#include "common/mapped_file.h"
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <spdlog/spdlog.h>
+
+namespace psh {
+
+MappedFile::~MappedFile() { Close(); }
+
+#ifdef _WIN32
+
+bool MappedFile::Create(const std::filesystem::path& path, size_t size) {
+    Close();
+    file_ = CreateFileW(path.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr,
+                        CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file_ == INVALID_HANDLE_VALUE) {
+        file_ = nullptr;
+        spdlog::error("Failed to create file: {}", path.string());
+        return false;
+    }
+    LARGE_INTEGER file_size;
+    file_size.QuadPart = static_cast<LONGLONG>(size);
+    mapping_ = CreateFileMappingW(file_, nullptr, PAGE_READWRITE,
+                                  file_size.HighPart, file_size.LowPart,
+                                  nullptr);
+    if (mapping_ == nullptr) {
+        spdlog::error("Failed to map file: {}", path.string());
+        Close();
+        return false;
+    }
+    data_ = static_cast<uint8_t*>(
+        MapViewOfFile(mapping_, FILE_MAP_WRITE, 0, 0, size));
+    if (data_ == nullptr) {
+        spdlog::error("Failed to map view of file: {}", path.string());
+        Close();
+        return false;
+    }
+    size_ = size;
+    return true;
+}
+
+bool MappedFile::Resize(size_t size) {
+    if (file_ == nullptr || data_ == nullptr || size == 0) {
+        return false;
+    }
+    // the view and the mapping pin the file size, drop them first
+    UnmapViewOfFile(data_);
+    data_ = nullptr;
+    CloseHandle(mapping_);
+    mapping_ = nullptr;
+    LARGE_INTEGER file_size;
+    file_size.QuadPart = static_cast<LONGLONG>(size);
+    if (!SetFilePointerEx(file_, file_size, nullptr, FILE_BEGIN) ||
+        !SetEndOfFile(file_)) {
+        spdlog::error("Failed to resize file to {} bytes", size);
+        Close();
+        return false;
+    }
+    mapping_ =
+        CreateFileMappingW(file_, nullptr, PAGE_READWRITE, 0, 0, nullptr);
+    if (mapping_ == nullptr) {
+        spdlog::error("Failed to map resized file");
+        Close();
+        return false;
+    }
+    data_ = static_cast<uint8_t*>(
+        MapViewOfFile(mapping_, FILE_MAP_WRITE, 0, 0, size));
+    if (data_ == nullptr) {
+        spdlog::error("Failed to map view of resized file");
+        Close();
+        return false;
+    }
+    size_ = size;
+    return true;
+}
+
+bool MappedFile::Open(const std::filesystem::path& path) {
+    Close();
+    file_ = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file_ == INVALID_HANDLE_VALUE) {
+        file_ = nullptr;
+        return false;
+    }
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file_, &file_size) || file_size.QuadPart == 0) {
+        Close();
+        return false;
+    }
+    mapping_ =
+        CreateFileMappingW(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping_ == nullptr) {
+        Close();
+        return false;
+    }
+    data_ = static_cast<uint8_t*>(
+        MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+    if (data_ == nullptr) {
+        Close();
+        return false;
+    }
+    size_ = static_cast<size_t>(file_size.QuadPart);
+    return true;
+}
+
+void MappedFile::Close() {
+    if (data_ != nullptr) {
+        UnmapViewOfFile(data_);
+        data_ = nullptr;
+    }
+    if (mapping_ != nullptr) {
+        CloseHandle(mapping_);
+        mapping_ = nullptr;
+    }
+    if (file_ != nullptr) {
+        CloseHandle(file_);
+        file_ = nullptr;
+    }
+    size_ = 0;
+}
+
+#else
+
+bool MappedFile::Create(const std::filesystem::path& path, size_t size) {
+    Close();
+    fd_ = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd_ < 0) {
+        spdlog::error("Failed to create file: {}", path.string());
+        return false;
+    }
+    if (ftruncate(fd_, static_cast<off_t>(size)) != 0) {
+        spdlog::error("Failed to resize file: {}", path.string());
+        Close();
+        return false;
+    }
+    void* data =
+        mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (data == MAP_FAILED) {
+        spdlog::error("Failed to map file: {}", path.string());
+        Close();
+        return false;
+    }
+    data_ = static_cast<uint8_t*>(data);
+    size_ = size;
+    return true;
+}
+
+bool MappedFile::Resize(size_t size) {
+    if (fd_ < 0 || data_ == nullptr || size == 0) {
+        return false;
+    }
+    munmap(data_, size_);
+    data_ = nullptr;
+    if (ftruncate(fd_, static_cast<off_t>(size)) != 0) {
+        spdlog::error("Failed to resize file to {} bytes", size);
+        Close();
+        return false;
+    }
+    void* data =
+        mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (data == MAP_FAILED) {
+        spdlog::error("Failed to map resized file");
+        Close();
+        return false;
+    }
+    data_ = static_cast<uint8_t*>(data);
+    size_ = size;
+    return true;
+}
+
+bool MappedFile::Open(const std::filesystem::path& path) {
+    Close();
+    fd_ = open(path.c_str(), O_RDONLY);
+    if (fd_ < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd_, &st) != 0 || st.st_size == 0) {
+        Close();
+        return false;
+    }
+    size_t size = static_cast<size_t>(st.st_size);
+    void* data = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd_, 0);
+    if (data == MAP_FAILED) {
+        Close();
+        return false;
+    }
+    data_ = static_cast<uint8_t*>(data);
+    size_ = size;
+    return true;
+}
+
+void MappedFile::Close() {
+    if (data_ != nullptr) {
+        munmap(data_, size_);
+        data_ = nullptr;
+    }
+    if (fd_ >= 0) {
+        close(fd_);
+        fd_ = -1;
+    }
+    size_ = 0;
+}
+
+#endif
+
+} // namespace psh
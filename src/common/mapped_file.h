@@ -0,0 +1,46 @@
+#pragma once
+
+#ifndef PSH_COMMON_MAPPED_FILE_H_
+#define PSH_COMMON_MAPPED_FILE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+namespace psh {
+
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // Creates or truncates the file to size bytes and maps it writable.
+    bool Create(const std::filesystem::path& path, size_t size);
+    // Grows or truncates a file mapped by Create and maps it again, Data
+    // changes. The file is closed when this fails.
+    bool Resize(size_t size);
+    // Maps an existing file read-only.
+    bool Open(const std::filesystem::path& path);
+    void Close();
+
+    bool IsOpened() const { return data_ != nullptr; }
+    uint8_t* Data() const { return data_; }
+    size_t Size() const { return size_; }
+
+private:
+    uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+#ifdef _WIN32
+    void* file_ = nullptr;
+    void* mapping_ = nullptr;
+#else
+    int fd_ = -1;
+#endif
+};
+
+} // namespace psh
+
+#endif // !PSH_COMMON_MAPPED_FILE_H_
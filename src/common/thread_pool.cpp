@@ -0,0 +1,67 @@
+#include "common/thread_pool.h"
+
+namespace psh {
+
+ThreadPool::ThreadPool(int worker_count) {
+    for (int i = 0; i < worker_count; ++i) {
+        workers_.emplace_back(&ThreadPool::WorkLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    task_cv_.notify_all();
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+}
+
+void ThreadPool::ParallelFor(int count, const std::function<void(int)>& task) {
+    if (count <= 0) {
+        return;
+    }
+    std::unique_lock<std::mutex> lock(mutex_);
+    task_ = &task;
+    count_ = count;
+    next_ = 0;
+    pending_ = count;
+    task_cv_.notify_all();
+
+    while (RunNext(lock)) {
+    }
+    done_cv_.wait(lock, [this]() { return pending_ == 0; });
+    task_ = nullptr;
+    count_ = 0;
+    next_ = 0;
+}
+
+void ThreadPool::WorkLoop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        task_cv_.wait(lock, [this]() { return stop_ || next_ < count_; });
+        if (stop_) {
+            return;
+        }
+        RunNext(lock);
+    }
+}
+
+bool ThreadPool::RunNext(std::unique_lock<std::mutex>& lock) {
+    if (next_ >= count_) {
+        return false;
+    }
+    int index = next_++;
+    const auto* task = task_;
+    lock.unlock();
+    (*task)(index);
+    lock.lock();
+    if (--pending_ == 0) {
+        done_cv_.notify_all();
+    }
+    return true;
+}
+
+} // namespace psh
@@ -0,0 +1,49 @@
+#pragma once
+
+#ifndef PSH_COMMON_THREAD_POOL_H_
+#define PSH_COMMON_THREAD_POOL_H_
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace psh {
+
+// Persistent workers for fork-join loops. ParallelFor must not be called
+// from several threads at once.
+class ThreadPool {
+public:
+    explicit ThreadPool(int worker_count);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // workers plus the calling thread
+    int GetConcurrency() const { return static_cast<int>(workers_.size()) + 1; }
+
+    // Runs task(0) .. task(count - 1) on the workers and the calling thread,
+    // returns once all of them finished.
+    void ParallelFor(int count, const std::function<void(int)>& task);
+
+private:
+    void WorkLoop();
+    // takes and runs one index, lock is held on entry and exit
+    bool RunNext(std::unique_lock<std::mutex>& lock);
+
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable task_cv_;
+    std::condition_variable done_cv_;
+    const std::function<void(int)>* task_ = nullptr;
+    int count_ = 0;
+    int next_ = 0;
+    int pending_ = 0;
+    bool stop_ = false;
+};
+
+} // namespace psh
+
+#endif // !PSH_COMMON_THREAD_POOL_H_
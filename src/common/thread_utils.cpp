@@ -0,0 +1,51 @@
+#include "common/thread_utils.h"
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace psh {
+
+#ifdef _WIN32
+
+bool SetCurrentThreadRealtime() {
+    return SetThreadPriority(GetCurrentThread(),
+                             THREAD_PRIORITY_TIME_CRITICAL) != 0;
+}
+
+bool SetCurrentThreadAffinity(int cpu) {
+    if (cpu < 0 || cpu >= static_cast<int>(sizeof(DWORD_PTR) * 8)) {
+        return false;
+    }
+    return SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR{1} << cpu) !=
+           0;
+}
+
+#else
+
+bool SetCurrentThreadRealtime() {
+    sched_param param{};
+    param.sched_priority = sched_get_priority_max(SCHED_FIFO);
+    return pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) == 0;
+}
+
+bool SetCurrentThreadAffinity(int cpu) {
+#ifdef __linux__
+    if (cpu < 0 || cpu >= CPU_SETSIZE) {
+        return false;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    return false;
+#endif
+}
+
+#endif
+
+} // namespace psh
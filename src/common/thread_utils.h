@@ -0,0 +1,16 @@
+#pragma once
+
+#ifndef PSH_COMMON_THREAD_UTILS_H_
+#define PSH_COMMON_THREAD_UTILS_H_
+
+namespace psh {
+
+// Raises the calling thread to the highest real-time priority the OS
+// grants, usually requires elevated rights on Linux.
+bool SetCurrentThreadRealtime();
+// Pins the calling thread to one cpu.
+bool SetCurrentThreadAffinity(int cpu);
+
+} // namespace psh
+
+#endif // !PSH_COMMON_THREAD_UTILS_H_
@@ -1,19 +1,60 @@
 #include "common/time_utils.h"
 
 #include <chrono>
+#include <thread>
 
-namespace psh {
+namespace {
 
-int64_t GetCurrentTimeMs() {
-    return std::chrono::duration_cast<std::chrono::milliseconds>(
-               std::chrono::steady_clock::now().time_since_epoch())
-        .count();
+psh::SteadyClock steady_clock;
+std::atomic<psh::IClock*> current_clock{&steady_clock};
+
+std::chrono::steady_clock::time_point ToTimePoint(int64_t time_ns) {
+    return std::chrono::steady_clock::time_point(
+        std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::nanoseconds(time_ns)));
 }
 
-int64_t GetCurrentTimeNs() {
+} // namespace
+
+namespace psh {
+
+int64_t SteadyClock::NowNs() {
     return std::chrono::duration_cast<std::chrono::nanoseconds>(
                std::chrono::steady_clock::now().time_since_epoch())
         .count();
 }
 
+void SteadyClock::SleepUntilNs(int64_t time_ns) {
+    std::this_thread::sleep_until(ToTimePoint(time_ns));
+}
+
+void SteadyClock::WaitUntilNs(std::unique_lock<std::mutex>& lock,
+                              std::condition_variable& cv, int64_t time_ns) {
+    cv.wait_until(lock, ToTimePoint(time_ns));
+}
+
+void VirtualClock::AdvanceTo(int64_t time_ns) {
+    int64_t now_ns = now_ns_.load(std::memory_order_relaxed);
+    while (now_ns < time_ns &&
+           !now_ns_.compare_exchange_weak(now_ns, time_ns,
+                                          std::memory_order_acq_rel)) {
+    }
+}
+
+void SetClock(IClock* clock) {
+    current_clock.store(clock != nullptr ? clock : &steady_clock,
+                        std::memory_order_release);
+}
+
+IClock& GetClock() { return *current_clock.load(std::memory_order_acquire); }
+
+int64_t GetCurrentTimeMs() { return NsToMs(GetClock().NowNs()); }
+
+int64_t GetCurrentTimeNs() { return GetClock().NowNs(); }
+
+void SleepForMs(int64_t duration_ms) {
+    IClock& clock = GetClock();
+    clock.SleepUntilNs(clock.NowNs() + MsToNs(duration_ms));
+}
+
 } // namespace psh
\ No newline at end of file
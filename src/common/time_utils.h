@@ -3,13 +3,75 @@
 #ifndef PSH_COMMON_TIME_UTILS_H_
 #define PSH_COMMON_TIME_UTILS_H_
 
+#include <atomic>
+#include <condition_variable>
 #include <cstdint>
+#include <mutex>
 
 namespace psh {
 
+// Source of the current time. Waiting goes through the clock as well, so a
+// simulated clock can jump to the deadline instead of sleeping.
+class IClock {
+public:
+    virtual ~IClock() {}
+
+    virtual int64_t NowNs() = 0;
+    virtual void SleepUntilNs(int64_t time_ns) = 0;
+    // waits on cv until it is notified or the clock reaches time_ns
+    virtual void WaitUntilNs(std::unique_lock<std::mutex>& lock,
+                             std::condition_variable& cv, int64_t time_ns) = 0;
+    // true when waits end exactly at their deadline, spinning is useless then
+    virtual bool WakesOnTime() const { return false; }
+};
+
+class SteadyClock : public IClock {
+public:
+    int64_t NowNs() override;
+    void SleepUntilNs(int64_t time_ns) override;
+    void WaitUntilNs(std::unique_lock<std::mutex>& lock,
+                     std::condition_variable& cv, int64_t time_ns) override;
+};
+
+// Simulated time that only moves when somebody waits. Every wait returns at
+// once and moves the time to its deadline, so a schedule runs as fast as it
+// is processed. Notifications are not waited for, streams have to be
+// scheduled before the waiting starts.
+// Only one thread may wait on it. The capture loop, the main loop and the
+// touch executor all wait through SleepForMs, and with several of them each
+// wait would push the shared time past the deadlines of the others. Install
+// it for a TouchExecutor running alone, see TestVirtualChartPlay in
+// test/psh_test.hpp.
+class VirtualClock : public IClock {
+public:
+    explicit VirtualClock(int64_t start_ns = 0) : now_ns_(start_ns) {}
+
+    int64_t NowNs() override { return now_ns_.load(std::memory_order_acquire); }
+    void SleepUntilNs(int64_t time_ns) override { AdvanceTo(time_ns); }
+    void WaitUntilNs(std::unique_lock<std::mutex>&, std::condition_variable&,
+                     int64_t time_ns) override {
+        AdvanceTo(time_ns);
+    }
+    bool WakesOnTime() const override { return true; }
+
+    // never moves the time backwards
+    void AdvanceTo(int64_t time_ns);
+    void AdvanceBy(int64_t duration_ns) { AdvanceTo(NowNs() + duration_ns); }
+
+private:
+    std::atomic<int64_t> now_ns_;
+};
+
+// The clock used by every time function below, nullptr restores the steady
+// clock. The clock must outlive its use.
+void SetClock(IClock* clock);
+IClock& GetClock();
+
 int64_t GetCurrentTimeMs();
 int64_t GetCurrentTimeNs();
+void SleepForMs(int64_t duration_ms);
 inline int64_t MsToNs(int64_t ms) { return ms * 1'000'000; }
+inline int64_t NsToMs(int64_t ns) { return ns / 1'000'000; }
 
 } // namespace psh
 
@@ -13,7 +13,10 @@ MumuClient::MumuClient(const QString& mumu_path_str, int mumu_inst_index,
     Init();
 }
 
-MumuClient::~MumuClient() { Uninit(); }
+MumuClient::~MumuClient() {
+    StopCapture();
+    Uninit();
+}
 
 bool MumuClient::Init() {
     inited_ = MLL::Init(mumu_path_) &&
@@ -30,6 +33,47 @@ void MumuClient::Uninit() {
 }
 
 cv::Mat MumuClient::Capture() {
+    cv::Mat dst;
+    CaptureTo(dst);
+    return dst;
+}
+
+void MumuClient::CaptureTo(cv::Mat& dst) {
+    CaptureDisplay();
+    cv::Mat raw(display_height_, display_width_, CV_8UC4,
+                display_buffer_.data());
+    cv::cvtColor(raw, bgr_buffer_, cv::COLOR_RGBA2BGR);
+    cv::flip(bgr_buffer_, dst, 0);
+}
+
+void MumuClient::CaptureTo(cv::Mat& dst,
+                           const std::vector<cv::Rect>& regions) {
+    CaptureDisplay();
+    cv::Mat raw(display_height_, display_width_, CV_8UC4,
+                display_buffer_.data());
+    if (dst.rows != display_height_ || dst.cols != display_width_ ||
+        dst.type() != CV_8UC3) {
+        // a new buffer is cleared once, pixels outside the regions must not
+        // be left uninitialized for readers of the whole frame
+        dst.create(display_height_, display_width_, CV_8UC3);
+        dst.setTo(cv::Scalar::all(0));
+    }
+
+    cv::Rect display_rect(0, 0, display_width_, display_height_);
+    for (cv::Rect region : regions) {
+        region &= display_rect;
+        // the display buffer is bottom-up, convert each row straight into
+        // its flipped position
+        for (int y = region.y; y < region.y + region.height; ++y) {
+            cv::Mat src_row = raw(cv::Rect(region.x, display_height_ - 1 - y,
+                                           region.width, 1));
+            cv::Mat dst_row = dst(cv::Rect(region.x, y, region.width, 1));
+            cv::cvtColor(src_row, dst_row, cv::COLOR_RGBA2BGR);
+        }
+    }
+}
+
+void MumuClient::CaptureDisplay() {
     int display_id = GetDisplayId();
     int ret = MLL::CaptureDisplay(
         mumu_handle_, display_id, static_cast<int>(display_buffer_.size()),
@@ -46,15 +90,6 @@ cv::Mat MumuClient::Capture() {
 			throw std::runtime_error("Failed to capture display");
 		}
     }
-
-    cv::Mat raw(display_height_, display_width_, CV_8UC4,
-                display_buffer_.data());
-    cv::Mat bgr;
-    cv::cvtColor(raw, bgr, cv::COLOR_RGBA2BGR);
-    cv::Mat dst;
-    cv::flip(bgr, dst, 0);
-
-    return dst;
 }
 
 void MumuClient::TouchDown(int slot_index, cv::Point pos) {
@@ -27,6 +27,8 @@ public:
     void Uninit();
 
     cv::Mat Capture() override;
+    void CaptureTo(cv::Mat& dst) override;
+    void CaptureTo(cv::Mat& dst, const std::vector<cv::Rect>& regions) override;
     int GetDisplayWidth() override { return display_width_; }
     int GetDisplayHeight() override { return display_height_; }
 
@@ -44,6 +46,7 @@ private:
     bool ConnectMumu(const std::filesystem::path& mumu_path,
                      int mumu_inst_index);
     int GetDisplayId();
+    void CaptureDisplay();
     bool InitScreencap();
 
     bool inited_ = false;
@@ -54,6 +57,7 @@ private:
     int mumu_inst_index_ = -1;
     QString package_name_;
     std::vector<uint8_t> display_buffer_;
+    cv::Mat bgr_buffer_;
 };
 
 } // namespace psh
@@ -27,7 +27,6 @@ constexpr int kHoldColorDelta = 20;
 
 constexpr int kSlideMoveDY		   = -200;
 constexpr int kSlideDurationMs	   = 30;
-constexpr int kSlideStepDelayMs	   = 1;
 constexpr int kSlideDelayMs		   = -20;
 constexpr int kHoldEndSlideDelayMs = -40;
 constexpr int kTapDurationMs	   = 20;
@@ -41,6 +40,8 @@ constexpr int kMinNoteDW      = 50;
 constexpr int64_t kMinLoopWaitTimeMs = 1;
 constexpr int64_t kMainLoopDelayMs   = 200;
 constexpr int64_t kDisplayDelayMs    = 1000 / 60;
+constexpr int     kCaptureIntervalMs = 1000 / 60;
+constexpr int     kRecordingCapacity = 360 * 1000 / kCaptureIntervalMs; // 6 min
 
 constexpr double kSongNameScale = 2.0;
 
@@ -79,7 +80,9 @@ inline const std::array<cv::Vec3b, static_cast<int>(SongStatus::Count)> kSongSta
 	cv::Vec3b{206, 204,  19}  // All Perfect
 };
 
-inline const std::string kWindowName = "Screen Show";
+inline const std::string kWindowName        = "Screen Show";
+inline const std::string kRecordingDir      = "recordings";
+inline const std::string kDispatchReportDir = "reports";
 // clang-format on
 
 } // namespace psh
@@ -1,6 +1,8 @@
 #include "player/auto_player.h"
 
-#include <deque>
+#include <filesystem>
+#include <unordered_map>
+#include <utility>
 
 #include <spdlog/spdlog.h>
 
@@ -12,9 +14,12 @@
 
 #include "common/time_utils.h"
 #include "common/finalizer.hpp"
+#include "common/thread_pool.h"
 #include "common/cv_utils.h"
 #include "sus/score_touch.h"
 #include "sus/sus_loader.h"
+#include "player/touch_plan.h"
+#include "touch/dispatch_recorder.h"
 #include "player/display_manager.h"
 #include "player/song_utils.h"
 
@@ -23,49 +28,78 @@ namespace MMW = MikuMikuWorld;
 namespace {
 using namespace psh;
 
-void FillExecutorByScoreTouch(TouchExecutor& executor,
-                              const ScoreTouch& score_touch,
-                              const HrLine& hit_line) {
-    constexpr double kLaneCount = 12.0;
-    for (const auto& note : score_touch.notes) {
-        cv::Point pos = hit_line.PosOf(note.lane / kLaneCount);
-        if (note.flick == MMW::FlickType::None) {
-            executor.TouchTap(note.delay_ms, pos, kTapDurationMs);
-        } else {
-            executor.TouchSlide(note.delay_ms + kSlideDelayMs, pos,
-                                pos + cv::Point{0, kSlideMoveDY},
-                                kSlideDurationMs, kSlideStepDelayMs, 1.0, 1.0);
-        }
+// Reuses the plan cached next to the chart when it was built for the same
+// chart and hit line, builds and caches it otherwise.
+TouchPlan PrepareTouchPlan(const SusLoader::SusResult& sus,
+                           const HrLine& hit_line) {
+    std::filesystem::path plan_path;
+    uint64_t chart_hash = 0;
+    uint64_t geometry_hash = GetTouchPlanGeometryHash(hit_line);
+    if (!sus.path.isEmpty()) {
+        std::filesystem::path chart_path(sus.path.toStdWString());
+        chart_hash = HashChartFile(chart_path);
+        plan_path = chart_path;
+        plan_path += kTouchPlanExtension;
     }
-    for (const auto& hold : score_touch.holds) {
-        TouchTaskStream tasks;
-        if (hold.start.flick == MMW::FlickType::None) {
-            tasks.AddTask(hold.start.delay_ms, TouchAction::Down,
-                          hit_line.PosOf(hold.start.lane / kLaneCount));
-        } else {
-            tasks.AddSlide(hold.start.delay_ms + kSlideDelayMs,
-                           hit_line.PosOf(hold.start.lane / kLaneCount) -
-                               cv::Point{0, kSlideMoveDY},
-                           hit_line.PosOf(hold.start.lane / kLaneCount),
-                           kSlideDurationMs, kSlideStepDelayMs, 1.0, 1.0, true,
-                           false);
-        }
-        for (const auto& step : hold.steps) {
-            tasks.AddTask(step.delay_ms, TouchAction::Move,
-                          hit_line.PosOf(step.lane / kLaneCount));
+    if (chart_hash != 0) {
+        if (auto plan = LoadTouchPlan(plan_path, chart_hash, geometry_hash)) {
+            spdlog::info("Loaded touch plan: {}", plan_path.string());
+            return std::move(*plan);
         }
-        if (hold.end.flick == MMW::FlickType::None) {
-            tasks.AddTask(hold.end.delay_ms, TouchAction::Up, {});
-        } else {
-            tasks.AddSlide(hold.end.delay_ms + kHoldEndSlideDelayMs,
-                           hit_line.PosOf(hold.end.lane / kLaneCount),
-                           hit_line.PosOf(hold.end.lane / kLaneCount) +
-                               cv::Point{0, kSlideMoveDY},
-                           kSlideDurationMs, kSlideStepDelayMs, 1.0, 1.0, false,
-                           true);
-        }
-        executor.Execute(std::move(tasks));
     }
+
+    MMW::ScoreConverter converter;
+    MMW::Score score = converter.susToScore(sus.sus);
+    TouchPlan plan = BuildTouchPlan(ScoreToTouch(score), hit_line);
+    if (chart_hash != 0 &&
+        SaveTouchPlan(plan_path, plan, chart_hash, geometry_hash)) {
+        spdlog::info("Saved touch plan: {}", plan_path.string());
+    }
+    return plan;
+}
+
+// Builds or loads the plan for the hit line of tc, the executor is left to
+// the play.
+std::shared_ptr<PreparedChart> PrepareChart(const SusLoader::SusResult& sus,
+                                            const TrackConfig& tc) {
+    auto prepared = std::make_shared<PreparedChart>();
+    prepared->hit_line = TrackGeometry::Get(tc)->GetHitLine();
+    prepared->plan = PrepareTouchPlan(sus, prepared->hit_line);
+    return prepared;
+}
+
+// Stops the executor first, so the report covers every task it sent and the
+// recorder no longer changes.
+void ReportDispatch(TouchExecutor& executor, const DispatchRecorder& recorder,
+                    bool export_files) {
+    executor.Stop();
+    DispatchStats stats = executor.GetDispatchStats();
+    auto records = recorder.Snapshot();
+    DispatchReport report = DispatchRecorder::Summarize(records);
+    spdlog::info("Touch dispatch: {} tasks, preempted: {}, dropped: {}",
+                 recorder.GetRecordedCount(), stats.preempted, stats.dropped);
+    if (records.empty()) {
+        return;
+    }
+    spdlog::info(
+        "Touch lateness of last {}: p50: {:.3f}ms, p95: {:.3f}ms, p99: "
+        "{:.3f}ms, max: {:.3f}ms",
+        report.count, report.late_p50_ns / 1e6, report.late_p95_ns / 1e6,
+        report.late_p99_ns / 1e6, report.late_max_ns / 1e6);
+    spdlog::info("ITouch call: p50: {:.3f}ms, p99: {:.3f}ms, max: {:.3f}ms",
+                 report.call_p50_ns / 1e6, report.call_p99_ns / 1e6,
+                 report.call_max_ns / 1e6);
+    spdlog::info("Touch lateness histogram:\n{}", report.FormatHistogram());
+
+    if (!export_files) {
+        return;
+    }
+    std::error_code ec;
+    std::filesystem::create_directories(kDispatchReportDir, ec);
+    auto path = std::filesystem::path(kDispatchReportDir) /
+                std::to_string(GetCurrentTimeMs());
+    DispatchRecorder::ExportCsv(path.string() + ".csv", records);
+    DispatchRecorder::ExportJson(path.string() + ".json", report);
 }
 
 } // namespace
@@ -108,42 +142,87 @@ void AutoPlayer::StartHoldTouch(TouchExecutor& executor,
     for (int i = 0; i < n; ++i) {
         cv::Point pos = hold_ranges[i].PosOf(0.5);
         TouchTaskStream task_stream;
+        task_stream.SetPriority(TouchPriority::kParked);
         task_stream.AddTask(0, TouchAction::Down, pos);
         executor.Execute(std::move(task_stream));
     }
 }
 
 void AutoPlayer::UpdateFrame() {
-    prev_frame_ = frame_;
     frame_ = screen_.GetFrame();
 }
 
-void AutoPlayer::ExecuteTouch(TouchExecutor& executor,
-                              std::deque<NoteSample>& s) const {
-    const auto& front = s.front();
-    if (front.touched) {
-        return;
+cv::Rect AutoPlayer::GetRecordRegion(const NoteFinder& finder) const {
+    switch (pc_.record_region) {
+        case RecordRegion::kTrackArea:
+            return finder.GetTrackArea();
+        case RecordRegion::kDisplay:
+            return {};
+        case RecordRegion::kCheckRegion:
+        default:
+            return finder.GetCheckRegion();
+    }
+}
+
+std::shared_ptr<FrameRecorder> AutoPlayer::StartRecording(
+    const cv::Rect& roi) {
+    if (!pc_.record_session) {
+        return nullptr;
     }
-    const auto& note = front.note;
+    std::error_code ec;
+    std::filesystem::create_directories(kRecordingDir, ec);
+    auto path = std::filesystem::path(kRecordingDir) /
+                (std::to_string(GetCurrentTimeMs()) + ".pshrec");
+    auto recorder = std::make_shared<FrameRecorder>();
+    if (!recorder->Start(
+            path, {screen_.GetDisplayWidth(), screen_.GetDisplayHeight()},
+            kRecordingCapacity, roi)) {
+        return nullptr;
+    }
+    screen_.SetRecorder(recorder);
+    return recorder;
+}
+
+TouchHandle AutoPlayer::ExecuteTouch(TouchExecutor& executor,
+                                     const Note& note) const {
     int64_t real_hit_time = note.hit_time_ms + pc_.cv_hit_delay_ms;
     if (note.IsHoldEnd() && note.is_slide) {
         TouchTaskStream task_stream;
+        task_stream.SetPriority(TouchPriority::kHold);
         task_stream.AddTask(real_hit_time + kHoldDelayMs, TouchAction::Down,
                             note.hit_pos);
         task_stream.AddSlide(real_hit_time + kHoldEndSlideDelayMs, note.hit_pos,
                              note.hit_pos + cv::Point{0, kSlideMoveDY},
-                             kSlideDurationMs, kSlideStepDelayMs, 1.0, 1.0,
-                             false, true);
-        executor.Execute(task_stream);
+                             kSlideDurationMs, 1.0, 1.0, false, true);
+        return executor.Execute(task_stream);
     } else if (note.is_slide) {
-        executor.TouchSlide(real_hit_time, note.hit_pos,
+        return executor.TouchSlide(real_hit_time, note.hit_pos,
                             note.hit_pos + cv::Point{0, kSlideMoveDY},
-                            kSlideDurationMs, kSlideStepDelayMs, 1.0, 1.0);
+                            kSlideDurationMs, 1.0, 1.0);
     } else if (note.IsHoldEnd()) {
-        executor.TouchTap(real_hit_time + kHoldDelayMs, note.hit_pos,
-                          -kHoldDelayMs);
+        TouchTaskStream task_stream;
+        task_stream.SetPriority(TouchPriority::kHold);
+        task_stream.AddTap(real_hit_time + kHoldDelayMs, note.hit_pos,
+                           -kHoldDelayMs);
+        return executor.Execute(std::move(task_stream));
     } else {
-        executor.TouchTap(real_hit_time, note.hit_pos, kTapDurationMs);
+        return executor.TouchTap(real_hit_time, note.hit_pos, kTapDurationMs);
+    }
+}
+
+void AutoPlayer::AmendTouch(TouchExecutor& executor, TouchHandle& handle,
+                            const Note& prev, const Note& note) const {
+    if (note.hold != prev.hold || note.is_slide != prev.is_slide) {
+        // a different gesture, only replace it when nothing was sent yet
+        if (handle.Cancel()) {
+            handle = ExecuteTouch(executor, note);
+        }
+        return;
+    }
+    int64_t execute_time_ms = handle.GetExecuteTimeMs();
+    if (execute_time_ms >= 0) {
+        handle.Reschedule(execute_time_ms + note.hit_time_ms -
+                          prev.hit_time_ms);
     }
 }
 
@@ -158,10 +237,20 @@ void AutoPlayer::MainLoop() {
     try {
         spdlog::info("Start auto play");
         Finalizer finalizer([this]() {
+            screen_.StopCapture();
             run_flag_.store(false, std::memory_order_release);
             emit playStopped();
             spdlog::info("Stop auto play");
         });
+        if (pc_.async_capture) {
+            screen_.StartCapture(kCaptureIntervalMs);
+        }
+
+        // the chart is converted while the song is selected
+        SusLoader::PrepareFunc prepare_chart =
+            [tc = tc_](const SusLoader::SusResult& sus) {
+                return PrepareChart(sus, tc);
+            };
 
         const Event* event = nullptr;
         const Event* prev_event = nullptr;
@@ -174,7 +263,7 @@ void AutoPlayer::MainLoop() {
             if (cur != nullptr) {
                 auto sus_ptr = pc_.sus_mode ? SusLoader::GetSus() : nullptr;
                 if (sus_ptr) {
-                    SusPlayLoop(sus_ptr->sus, *cur);
+                    SusPlayLoop(*sus_ptr, *cur);
                 } else {
                     if (pc_.sus_mode) {
                         spdlog::info("SUS not ready yet, use cv play");
@@ -185,7 +274,7 @@ void AutoPlayer::MainLoop() {
                     PlayMode::kOnce) {
                     return;
                 }
-                std::this_thread::sleep_for(std::chrono::milliseconds(5000));
+                SleepForMs(5000);
                 event = nullptr;
                 prev_event = nullptr;
                 count = 0;
@@ -195,8 +284,7 @@ void AutoPlayer::MainLoop() {
                         return;
                     }
                     touch_.TouchTap(e->GetButton(QString("next1")));
-                    std::this_thread::sleep_for(
-                        std::chrono::milliseconds(1000));
+                    SleepForMs(1000);
                     UpdateFrame();
                 }
                 continue;
@@ -241,8 +329,9 @@ void AutoPlayer::MainLoop() {
                                 const QString& diff_str =
                                     kDifficultyStrs[static_cast<int>(
                                         *diff_opt)];
-                                SusLoader::LoadSusByImg(song_name_img,
-                                                        diff_str);
+                                SusLoader::LoadSusByImg(
+                                    song_name_img, diff_str, false, false,
+                                    prepare_chart);
                             }
                         }
                         if (count == 5 && mode == PlayMode::kSolo) {
@@ -259,14 +348,15 @@ void AutoPlayer::MainLoop() {
 
                         int64_t cur_time_ms = GetCurrentTimeMs();
                         touch_.TouchTap(cur->GetButton(diff_str));
-                        std::this_thread::sleep_for(
-                            std::chrono::milliseconds(1000));
+                        SleepForMs(1000);
                         touch_.TouchTap(cur->GetButton("confirm"));
 
                         if (pc_.sus_mode) {
                             auto song_name_img = GetSongNameImg(
                                 frame_.img, cur->GetArea("song_name"));
-                            SusLoader::LoadSusByImg(song_name_img, diff_str);
+                            SusLoader::LoadSusByImg(song_name_img, diff_str,
+                                                    false, false,
+                                                    prepare_chart);
                         }
 
                     } else if (cur->GetName() == "main_menu") {
@@ -292,8 +382,7 @@ void AutoPlayer::MainLoop() {
                     } 
                 }
             }
-            std::this_thread::sleep_for(
-                std::chrono::milliseconds(kMainLoopDelayMs));
+            SleepForMs(kMainLoopDelayMs);
         }
     } catch (const std::exception& e) {
         spdlog::error("Auto play error: {}", e.what());
@@ -303,6 +392,8 @@ class StopChecker {
 public:
     StopChecker(cv::Point pos) : pos_(pos) {}
 
+    cv::Rect GetRegion() const { return cv::Rect(pos_, cv::Size(1, 1)); }
+
     bool Check(const Frame& frame) {
         cv::Vec3b color = frame.img.at<cv::Vec3b>(pos_);
         if (counter_ < 0) {
@@ -350,18 +441,45 @@ private:
 
 void AutoPlayer::SimpleCvPlayLoop(const Event& event) {
     spdlog::info("Start simple cv auto play");
-    Finalizer finalizer([this]() { spdlog::info("Stop simple cv auto play"); });
+    Finalizer finalizer([this]() {
+        screen_.SetCaptureRegions({});
+        screen_.SetRecorder(nullptr);
+        spdlog::info("Stop simple cv auto play");
+    });
 
     try {
-        TouchExecutor executor = touch_.CreateExecutor();
+        TouchExecutor executor = touch_.CreateExecutor(pc_.scheduler);
+        executor.SetThreadConfig(pc_.touch_thread);
+        auto dispatch_recorder = std::make_shared<DispatchRecorder>();
+        executor.SetRecorder(dispatch_recorder);
         executor.Start();
+        Finalizer report([&]() {
+            ReportDispatch(executor, *dispatch_recorder, pc_.export_dispatch);
+        });
         NoteTimeEstimator estimator(pc_.speed_factor);
         NoteFinder finder(estimator, tc_);
+        std::optional<ThreadPool> pool;
+        if (pc_.detect_threads > 1) {
+            pool.emplace(pc_.detect_threads - 1);
+            finder.SetThreadPool(&*pool);
+        }
         StopChecker stop_checker(event.GetPoint("hp"));
         StartHoldTouch(executor, finder.GetHitLine());
+        cv::Rect record_region = GetRecordRegion(finder);
+        auto recorder = StartRecording(record_region);
+        // pixels outside of the capture regions would be recorded stale
+        std::vector<cv::Rect> capture_regions = {finder.GetCheckRegion(),
+                                                 stop_checker.GetRegion()};
+        if (recorder && record_region.empty()) {
+            capture_regions.clear();
+        } else if (recorder) {
+            capture_regions.push_back(record_region);
+        }
+        screen_.SetCaptureRegions(std::move(capture_regions));
 
-        std::vector<std::deque<NoteSample>> samples(4);
-        int min_sample_count = CalcMinSampleCount(estimator, 0.3);
+        NoteTracker tracker(CalcMinSampleCount(estimator, 0.3));
+        std::vector<NoteUpdate> updates;
+        std::unordered_map<int, std::pair<TouchHandle, Note>> touches;
 
         int64_t check_time_ms = GetCurrentTimeMs();
         while (run_flag_.load(std::memory_order_acquire)) {
@@ -369,9 +487,10 @@ void AutoPlayer::SimpleCvPlayLoop(const Event& event) {
             if (cur_time_ms >= check_time_ms) {
                 UpdateFrame();
 
-                if (!prev_frame_.img.empty() &&
-                    cv::norm(prev_frame_.img, frame_.img, cv::NORM_L2) == 0) {
-                    spdlog::debug("Frame is the same as previous, skipping");
+                if (!frame_.is_new) {
+                    // the async capture hands back the same frame until the
+                    // next capture, wait for it instead of spinning
+                    screen_.WaitForNewFrame(kCaptureIntervalMs);
                     continue;
                 }
 
@@ -379,43 +498,28 @@ void AutoPlayer::SimpleCvPlayLoop(const Event& event) {
                     return;
                 }
 
-                auto found = finder.FindAllNotes(frame_);
-                for (auto& each : found) {
-                    auto& pre = samples[static_cast<int>(each.first)];
-                    auto& cur = each.second;
-                    std::vector<int8_t> matched(cur.size(), 0);
-
-                    for (int i = 0; i < pre.size();) {
-                        bool found = false;
-                        for (int j = 0; j < cur.size(); ++j) {
-                            if (!matched[j] &&
-                                std::abs(pre[i].note.hit_time_ms -
-                                         cur[j].hit_time_ms) < kMinNoteDT &&
-                                std::abs(pre[i].note.hit_pos.x -
-                                         cur[j].hit_pos.x) < kMinNoteDX) {
-                                pre[i].AddSample(cur[j]);
-                                matched[j] = true;
-                                found = true;
-                                break;
-                            }
-                        }
-                        if (!found && i == 0) {
-                            if (pre[i].count > min_sample_count) {
-                                ExecuteTouch(executor, pre);
-                            } else {
-                                spdlog::info("Note has too few samples: {}",
-                                             pre[i].count);
-                            }
-                            pre.pop_front();
-                        } else {
-                            ++i;
-                        }
+                auto found =
+                    pc_.incremental_scan
+                        ? finder.FindNotes(frame_, tracker.GetTrackedNotes())
+                        : finder.FindAllNotes(frame_);
+                updates.clear();
+                tracker.Update(frame_.capture_time_ms, found, updates);
+                for (const auto& update : updates) {
+                    auto it = touches.find(update.id);
+                    if (!update.amend) {
+                        touches[update.id] = {
+                            ExecuteTouch(executor, update.note), update.note};
+                    } else if (it != touches.end()) {
+                        auto& [handle, note] = it->second;
+                        AmendTouch(executor, handle, note, update.note);
+                        note = update.note;
                     }
-
-                    for (int i = 0; i < cur.size(); ++i) {
-                        if (!matched[i]) {
-                            pre.emplace_back(cur[i]);
-                        }
+                }
+                for (auto it = touches.begin(); it != touches.end();) {
+                    if (it->second.first.IsPending()) {
+                        ++it;
+                    } else {
+                        it = touches.erase(it);
                     }
                 }
 
@@ -428,42 +532,46 @@ void AutoPlayer::SimpleCvPlayLoop(const Event& event) {
             cur_time_ms = GetCurrentTimeMs();
             auto wait_time =
                 std::max(kMinLoopWaitTimeMs, check_time_ms - cur_time_ms);
-            std::this_thread::sleep_for(std::chrono::milliseconds(wait_time));
+            SleepForMs(wait_time);
         }
     } catch (const std::exception& e) {
         spdlog::error("Simple cv play error: {}", e.what());
     }
 }
 
-void AutoPlayer::SusPlayLoop(const MikuMikuWorld::SUS& sus,
+void AutoPlayer::SusPlayLoop(const SusLoader::SusResult& sus,
                              const Event& event) {
     spdlog::info("Start SUS play");
-    Finalizer finalizer([this]() { spdlog::info("Stop SUS play"); });
+    Finalizer finalizer([this]() {
+        screen_.SetCaptureRegions({});
+        spdlog::info("Stop SUS play");
+    });
 
     try {
-        MMW::ScoreConverter converter;
-        MMW::Score score = converter.susToScore(sus);
-        ScoreTouch score_touch = ScoreToTouch(score);
-
         NoteTimeEstimator estimator(pc_.speed_factor);
         NoteFinder finder(estimator, tc_);
-        HrLine hit_line = finder.GetHitLine();
-        TouchExecutor executor = touch_.CreateExecutor();
-
-        FillExecutorByScoreTouch(executor, score_touch, hit_line);
-
-        int first_note_ms = INT_MAX;
-        for (const auto& note : score_touch.notes) {
-            first_note_ms = std::min(first_note_ms, note.delay_ms);
-        }
-        for (const auto& hold : score_touch.holds) {
-            first_note_ms = std::min(first_note_ms, hold.start.delay_ms);
+        std::shared_ptr<PreparedChart> prepared = sus.prepared;
+        if (!prepared || prepared->hit_line != finder.GetHitLine()) {
+            prepared = PrepareChart(sus, tc_);
+        } else {
+            spdlog::info("Use chart prepared during song selection");
         }
+        const TouchPlan& plan = prepared->plan;
+        int first_note_ms = plan.first_note_ms;
         if (first_note_ms == INT_MAX) {
             spdlog::warn("No valid tap notes in the score");
             return;
         }
 
+        auto dispatch_recorder = std::make_shared<DispatchRecorder>();
+        TouchExecutor executor = touch_.CreateExecutor(pc_.scheduler);
+        executor.SetThreadConfig(pc_.touch_thread);
+        executor.SetRecorder(dispatch_recorder);
+        for (const auto& stream : plan.streams) {
+            executor.Execute(stream);
+        }
+
+        screen_.SetCaptureRegions({finder.GetTrackArea()});
         UpdateFrame();
         cv::Mat track_img = finder.GetTrackImg(frame_.img);
 
@@ -501,15 +609,18 @@ void AutoPlayer::SusPlayLoop(const MikuMikuWorld::SUS& sus,
             }
 
             DisplayManager::UpdateDisplay(frame_.img, touch_, {});
-            std::this_thread::sleep_for(
-                std::chrono::milliseconds(pc_.check_loop_delay_ms));
+            SleepForMs(pc_.check_loop_delay_ms);
         }
 
         executor.SetBaseTime(start_time_ms - first_note_ms +
                              pc_.sus_hit_delay_ms);
         executor.Start();
+        Finalizer report([&]() {
+            ReportDispatch(executor, *dispatch_recorder, pc_.export_dispatch);
+        });
 
         StopChecker stop_checker(event.GetPoint("hp"));
+        screen_.SetCaptureRegions({stop_checker.GetRegion()});
         while (run_flag_.load(std::memory_order_acquire)) {
             UpdateFrame();
             if (!stop_checker.Check(frame_)) {
@@ -519,7 +630,7 @@ void AutoPlayer::SusPlayLoop(const MikuMikuWorld::SUS& sus,
                 DisplayManager::UpdateDisplay(frame_.img, touch_, {})
                     ? kDisplayDelayMs
                     : 200;
-            std::this_thread::sleep_for(std::chrono::milliseconds(wait_ms));
+            SleepForMs(wait_ms);
         }
     } catch (const std::exception& e) {
         spdlog::error("SusPlay error: {}", e.what());
@@ -10,6 +10,7 @@
 #include <optional>
 #include <functional>
 #include <future>
+#include <memory>
 
 #include <opencv2/opencv.hpp>
 #include <MikuMikuWorld/SUS.h>
@@ -19,22 +20,38 @@
 #include "touch/i_touch.h"
 #include "screen/i_screen.h"
 #include "screen/events.h"
+#include "screen/frame_recorder.h"
 #include "player/auto_play_constant.h"
 #include "player/note_time_estimator.h"
-#include "player/note_sample.h"
+#include "player/note_tracker.h"
+#include "sus/sus_loader.h"
 
 namespace psh {
 
+// Part of the display a session recording keeps. The check region is enough
+// to replay the note detection of the cv play loop, scripts/drop_fn samples
+// lanes down to the hit line and needs the track area, replaying the event
+// detection of the main loop needs the whole display.
+enum class RecordRegion { kCheckRegion, kTrackArea, kDisplay };
+
 // clang-format off
 struct PlayConfig {
-    int hold_cnt             = 6;
-    int check_loop_delay_ms  = 50;
-    int cv_hit_delay_ms      = -40;
-    int sus_hit_delay_ms     = -30;
-    SpeedFactor speed_factor = SpeedFactor::kSpeed10x;
-    SongDifficulty max_diff  = SongDifficulty::kHard;
-    bool sus_mode            = false;
-    bool auto_select         = false;
+    int hold_cnt                 = 6;
+    int check_loop_delay_ms      = 50;
+    int cv_hit_delay_ms          = -40;
+    int sus_hit_delay_ms         = -30;
+    SpeedFactor speed_factor     = SpeedFactor::kSpeed10x;
+    SongDifficulty max_diff      = SongDifficulty::kHard;
+    bool sus_mode                = false;
+    bool auto_select             = false;
+    bool async_capture           = false;
+    bool record_session          = false;
+    RecordRegion record_region   = RecordRegion::kCheckRegion;
+    bool incremental_scan        = false;
+    int detect_threads           = 1;
+    TouchSchedulerType scheduler = TouchSchedulerType::kHeap;
+    TouchThreadConfig touch_thread;
+    bool export_dispatch         = false;
 };
 // clang-format on
 
@@ -64,12 +81,17 @@ signals:
 private:
     void MainLoop();
     void SimpleCvPlayLoop(const Event &event);
-    void SusPlayLoop(const MikuMikuWorld::SUS &sus, const Event &event);
+    void SusPlayLoop(const SusLoader::SusResult &sus, const Event &event);
 
     void StartHoldTouch(TouchExecutor &executor, HrLine hit_line) const;
-    void ExecuteTouch(TouchExecutor &executor, std::deque<NoteSample> &s) const;
+    TouchHandle ExecuteTouch(TouchExecutor &executor, const Note &note) const;
+    void AmendTouch(TouchExecutor &executor, TouchHandle &handle,
+                    const Note &prev, const Note &note) const;
 
     void UpdateFrame();
+    // empty when the whole display is recorded
+    cv::Rect GetRecordRegion(const NoteFinder &finder) const;
+    std::shared_ptr<FrameRecorder> StartRecording(const cv::Rect &roi);
 
     int CalcMinSampleCount(NoteTimeEstimator &estimator, double factor) const;
 
@@ -78,7 +100,6 @@ private:
     std::atomic<PlayMode> play_mode_{PlayMode::kOnce};
 
     Frame frame_;
-    Frame prev_frame_;
 
     IScreen &screen_;
     TouchController &touch_;
@@ -1,77 +1,148 @@
 #include "player/note_finder.h"
 
+#include <algorithm>
+#include <cmath>
+
 #include "common/cv_utils.h"
 
 namespace {
 
 cv::Point CenterOf(const cv::Rect &rect) { return (rect.tl() + rect.br()) / 2; }
 
+std::vector<std::pair<psh::NoteColor, std::vector<psh::Note>>>
+CreateNoteGroups() {
+    std::vector<std::pair<psh::NoteColor, std::vector<psh::Note>>> ret;
+    for (int i = 0; i < psh::kNoteColors.size(); ++i) {
+        ret.emplace_back(static_cast<psh::NoteColor>(i),
+                         std::vector<psh::Note>{});
+    }
+    return ret;
+}
+
+// Windows touching each other are merged so that no blob is split or found
+// twice.
+void AddWindow(std::vector<cv::Rect> &windows, cv::Rect window) {
+    bool merged = true;
+    while (merged) {
+        merged = false;
+        cv::Rect grown(window.x - 1, window.y - 1, window.width + 2,
+                       window.height + 2);
+        for (auto it = windows.begin(); it != windows.end(); ++it) {
+            if ((grown & *it).area() > 0) {
+                window |= *it;
+                windows.erase(it);
+                merged = true;
+                break;
+            }
+        }
+    }
+    windows.push_back(window);
+}
+
 } // namespace
 
 namespace psh {
 
 NoteFinder::NoteFinder(NoteTimeEstimator &estimator,
                        const TrackConfig &track_config)
-    : estimator_(estimator), tc_(track_config) {
-    HrLine track_upper = TrackLineOf(0);
-    HrLine track_lower = TrackLineOf(tc_.height);
-    HrLine check_upper = TrackLineOf(tc_.check_upper_y);
-    HrLine check_lower = TrackLineOf(tc_.check_lower_y);
-    hit_line_ = TrackLineOf(tc_.hit_line_y);
-
-    auto build_mask = [](const HrLine& upper, const HrLine& lower, cv::Rect& area, cv::Mat& mask) {
-		area = cv::Rect(lower.pos.x, upper.pos.y, lower.length,
-						lower.pos.y - upper.pos.y);
-		mask = cv::Mat::zeros(area.height, area.width, CV_8UC1);
-		std::vector<std::vector<cv::Point>> mask_pts = {
-			{upper.Left() - area.tl(), upper.Right() - area.tl(),
-			 lower.Right() - area.tl(), lower.Left() - area.tl()}};
-		cv::fillPoly(mask, mask_pts, cv::Scalar(255));
-	};
-
-    build_mask(track_upper, track_lower, track_area_, track_mask_);
-    build_mask(check_upper, check_lower, check_area_, check_mask_);
-}
+    : estimator_(estimator), geometry_(TrackGeometry::Get(track_config)) {}
 
 std::vector<std::pair<NoteColor, std::vector<Note>>> NoteFinder::FindAllNotes(
     const Frame &frame) {
-    cv::Mat check_img;
-    frame.img(check_area_).copyTo(check_img, check_mask_);
-    std::vector<std::pair<NoteColor, std::vector<Note>>> ret;
-
-    for (int i = 0; i < kNoteColors.size(); ++i) {
-        NoteColor color_enum = static_cast<NoteColor>(i);
-        const cv::Scalar &color = kNoteColors[i];
-
-        std::vector<Note> notes;
-        cv::Mat mask = CreateMask(check_img, color, kTapColorDelta);
-        cv::findContours(mask, note_contours_, cv::RETR_EXTERNAL,
-                         cv::CHAIN_APPROX_SIMPLE);
-        for (const auto &contour : note_contours_) {
-            cv::Rect box = cv::boundingRect(contour) + check_area_.tl();
-            cv::Point pos = CenterOf(box);
-            if (box.width >= kMinNoteWidth) {
-                // clang-format off
-                Note note;
-                note.color       = color_enum;
-                note.box         = box;
-                note.hit_pos     = hit_line_.PosOf(TrackLineOf(pos.y), pos);
-                note.hit_time_ms = estimator_.EstimateHitTime(pos.y) + frame.capture_time_ms;
-                note.hold        = FindHoldType(frame, color_enum, box);
-                note.is_slide    = color_enum == NoteColor::Red || color_enum == NoteColor::Yellow;
-                // clang-format on
-                notes.push_back(note);
-            }
+    auto ret = CreateNoteGroups();
+    scans_since_full_ = 0;
+    ScanRegion(frame, {{0, 0}, geometry_->GetCheckArea().size()}, ret);
+    return ret;
+}
+
+std::vector<std::pair<NoteColor, std::vector<Note>>> NoteFinder::FindNotes(
+    const Frame &frame, const std::vector<Note> &tracked) {
+    if (++scans_since_full_ >= kFullScanInterval) {
+        return FindAllNotes(frame);
+    }
+
+    cv::Rect bounds({0, 0}, geometry_->GetCheckArea().size());
+    std::vector<cv::Rect> windows = {
+        cv::Rect(0, 0, bounds.width, kEntryBandHeight) & bounds};
+    for (const auto &note : tracked) {
+        cv::Rect window =
+            PredictWindow(note, frame.capture_time_ms) & bounds;
+        if (!window.empty()) {
+            AddWindow(windows, window);
         }
-        ret.emplace_back(color_enum, std::move(notes));
     }
 
+    auto ret = CreateNoteGroups();
+    for (const auto &window : windows) {
+        ScanRegion(frame, window, ret);
+    }
+    for (auto &[color, notes] : ret) {
+        std::sort(notes.begin(), notes.end(),
+                  [](const Note &lhs, const Note &rhs) {
+                      return lhs.box.br().y > rhs.box.br().y;
+                  });
+    }
     return ret;
 }
 
+void NoteFinder::ScanRegion(
+    const Frame &frame, const cv::Rect &region,
+    std::vector<std::pair<NoteColor, std::vector<Note>>> &ret) {
+    cv::Rect rect = region + geometry_->GetCheckArea().tl();
+    cv::Mat mask = geometry_->GetCheckMask()(region);
+    const std::vector<NoteBlob> *blobs;
+    if (pool_ != nullptr) {
+        blobs = &labeler_.FindBlobs(frame.img(rect), mask, note_labels_,
+                                    *pool_, rect.tl(), kMinNoteWidth,
+                                    kMinNoteArea);
+    } else {
+        labeler_.Label(frame.img(rect), mask, note_labels_);
+        blobs = &labeler_.FindBlobs(note_labels_, rect.tl(), kMinNoteWidth,
+                                    kMinNoteArea);
+    }
+    for (const auto &blob : *blobs) {
+        const cv::Rect &box = blob.box;
+        cv::Point pos(static_cast<int>(std::lround(blob.centroid.x)),
+                      static_cast<int>(std::lround(blob.centroid.y)));
+        int64_t delay_ms =
+            std::llround(estimator_.EstimateHitTime(blob.centroid.y));
+        // clang-format off
+        Note note;
+        note.color       = blob.color;
+        note.box         = box;
+        note.hit_pos     = geometry_->ProjectToHitLine(pos);
+        note.hit_time_ms = delay_ms + frame.capture_time_ms;
+        note.hold        = FindHoldType(frame, blob.color, box);
+        note.is_slide    = blob.color == NoteColor::Red || blob.color == NoteColor::Yellow;
+        // clang-format on
+        ret[static_cast<int>(blob.color)].second.push_back(note);
+    }
+}
+
+cv::Rect NoteFinder::PredictWindow(const Note &note, int64_t time_ms) {
+    int y = estimator_.EstimatePosY(
+        static_cast<int>(note.hit_time_ms - time_ms));
+    // scale the box along the track perspective
+    HrLine from = geometry_->LineOf(CenterOf(note.box).y);
+    HrLine to = geometry_->LineOf(y);
+    int left = to.PosOf(from, note.box.tl()).x;
+    int right = to.PosOf(from, note.box.br()).x;
+    int half_height = note.box.height * to.length / from.length / 2;
+    return cv::Rect(left - kTrackWindowDX, y - half_height - kTrackWindowDY,
+                    right - left + 2 * kTrackWindowDX,
+                    2 * (half_height + kTrackWindowDY)) -
+           geometry_->GetCheckArea().tl();
+}
+
+cv::Rect NoteFinder::GetCheckRegion() const {
+    const cv::Rect &check_area = geometry_->GetCheckArea();
+    return cv::Rect(check_area.x, check_area.y - kHoldCheckDY,
+                    check_area.width, check_area.height + 2 * kHoldCheckDY);
+}
+
 cv::Mat NoteFinder::GetTrackImg(const cv::Mat &img) const { 
 	cv::Mat track_img;
-	img(track_area_).copyTo(track_img, track_mask_);
+	img(geometry_->GetTrackArea()).copyTo(track_img, geometry_->GetTrackMask());
 	return track_img;
 }
 
@@ -100,10 +171,4 @@ HoldType NoteFinder::FindHoldType(const Frame &frame, NoteColor color,
     return HoldType::None;
 }
 
-HrLine NoteFinder::TrackLineOf(int line_y) const {
-    int a =
-        (tc_.lower_len - tc_.upper_len) * (tc_.height - line_y) / tc_.height;
-    return HrLine{cv::Point{tc_.dx + a / 2, line_y}, tc_.lower_len - a};
-}
-
 } // namespace psh
\ No newline at end of file
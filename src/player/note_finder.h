@@ -3,6 +3,7 @@
 #ifndef PSH_PLAYER_NOTE_FINDER_H_
 #define PSH_PLAYER_NOTE_FINDER_H_
 
+#include <memory>
 #include <vector>
 #include <qstring.h>
 
@@ -10,24 +11,14 @@
 
 #include "screen/i_screen.h"
 #include "common/hr_line.h"
+#include "common/thread_pool.h"
 #include "player/auto_play_constant.h"
+#include "player/note_labeler.h"
 #include "player/note_time_estimator.h"
+#include "player/track_geometry.h"
 
 namespace psh {
 
-// clang-format off
-struct TrackConfig {
-    int upper_len     = 59;
-    int lower_len     = 1260;
-    int height        = 720; 
-    int hit_line_y    = 567;
-    int check_upper_y = 0;
-    int check_lower_y = 270;
-    int dx            = 10;
-    int dy            = 0;
-};
-// clang-format on
-
 struct Note {
     bool is_slide;
     HoldType hold;
@@ -44,7 +35,12 @@ struct Note {
 class NoteFinder {
 public:
     static constexpr int kMinNoteWidth = 5;
+    static constexpr int kMinNoteArea = 10;
     static constexpr int kHoldCheckDY = 6;
+    static constexpr int kEntryBandHeight = 80;
+    static constexpr int kTrackWindowDX = 20;
+    static constexpr int kTrackWindowDY = 20;
+    static constexpr int kFullScanInterval = 10;
 
     NoteFinder(NoteTimeEstimator& estimator, const TrackConfig& track_config);
     NoteFinder(const NoteFinder&) = default;
@@ -52,22 +48,33 @@ public:
 
     std::vector<std::pair<NoteColor, std::vector<Note>>> FindAllNotes(
         const Frame& frame);
-    HrLine GetHitLine() const { return hit_line_; }
+    // Only scans the entry band below check_upper_y and windows around the
+    // predicted positions of the tracked notes. Falls back to FindAllNotes
+    // every kFullScanInterval calls.
+    std::vector<std::pair<NoteColor, std::vector<Note>>> FindNotes(
+        const Frame& frame, const std::vector<Note>& tracked);
+    // Labels in stripes on pool when set, the pool must outlive the finder.
+    void SetThreadPool(ThreadPool* pool) { pool_ = pool; }
+    HrLine GetHitLine() const { return geometry_->GetHitLine(); }
+    cv::Rect GetTrackArea() const { return geometry_->GetTrackArea(); }
+    // screen region read by FindAllNotes, including the hold checks
+    cv::Rect GetCheckRegion() const;
     cv::Mat GetTrackImg(const cv::Mat& img) const;
 
 private:
+    // region is relative to the check area
+    void ScanRegion(const Frame& frame, const cv::Rect& region,
+                    std::vector<std::pair<NoteColor, std::vector<Note>>>& ret);
+    cv::Rect PredictWindow(const Note& note, int64_t time_ms);
     HoldType FindHoldType(const Frame& frame, NoteColor color, cv::Rect rect);
-    HrLine TrackLineOf(int line_y) const;
 
     NoteTimeEstimator& estimator_;
 
-    std::vector<std::vector<cv::Point>> note_contours_;
-    TrackConfig tc_;
-    cv::Rect track_area_;
-    cv::Rect check_area_;
-    cv::Mat track_mask_;
-    cv::Mat check_mask_;
-    HrLine hit_line_;
+    NoteLabeler labeler_;
+    cv::Mat note_labels_;
+    ThreadPool* pool_ = nullptr;
+    int scans_since_full_ = 0;
+    std::shared_ptr<const TrackGeometry> geometry_;
 };
 
 } // namespace psh
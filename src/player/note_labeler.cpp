@@ -0,0 +1,205 @@
+#include "player/note_labeler.h"
+
+#include <algorithm>
+
+namespace psh {
+
+static_assert(NoteLabeler::kColorCount <= 8,
+              "Color bit sets must fit into uint8_t");
+
+NoteLabeler::NoteLabeler(int delta) {
+    for (int c = 0; c < kColorCount; ++c) {
+        const cv::Vec3b& color = kNoteColors[c];
+        for (int ch = 0; ch < 3; ++ch) {
+            int lower = std::max(0, color[ch] - delta);
+            int upper = std::min(255, color[ch] + delta);
+            for (int v = lower; v <= upper; ++v) {
+                channel_lut_[ch][v] |= static_cast<uint8_t>(1 << c);
+            }
+        }
+    }
+    // overlapping colors resolve to the lowest index
+    for (int bits = 1; bits < static_cast<int>(bits_to_label_.size());
+         ++bits) {
+        int c = 0;
+        while (!(bits & (1 << c))) ++c;
+        bits_to_label_[bits] = static_cast<uint8_t>(c + 1);
+    }
+}
+
+void NoteLabeler::Label(const cv::Mat& img, const cv::Mat& mask,
+                        cv::Mat& labels) const {
+    CV_Assert(img.type() == CV_8UC3 && mask.type() == CV_8UC1 &&
+              img.size() == mask.size());
+    labels.create(img.size(), CV_8UC1);
+
+    const auto& lut_b = channel_lut_[0];
+    const auto& lut_g = channel_lut_[1];
+    const auto& lut_r = channel_lut_[2];
+    for (int y = 0; y < img.rows; ++y) {
+        const uchar* src = img.ptr<uchar>(y);
+        const uchar* m = mask.ptr<uchar>(y);
+        uchar* dst = labels.ptr<uchar>(y);
+        for (int x = 0; x < img.cols; ++x, src += 3) {
+            uint8_t bits = m[x] ? lut_b[src[0]] & lut_g[src[1]] & lut_r[src[2]]
+                                : 0;
+            dst[x] = bits_to_label_[bits];
+        }
+    }
+}
+
+const std::vector<NoteBlob>& NoteLabeler::FindBlobs(const cv::Mat& labels,
+                                                    cv::Point offset,
+                                                    int min_width,
+                                                    int min_area) {
+    CV_Assert(labels.type() == CV_8UC1);
+    ScanRuns(labels, 0, labels.rows, runs_);
+    return CollectBlobs(offset, min_width, min_area);
+}
+
+const std::vector<NoteBlob>& NoteLabeler::FindBlobs(
+    const cv::Mat& img, const cv::Mat& mask, cv::Mat& labels,
+    ThreadPool& pool, cv::Point offset, int min_width, int min_area) {
+    CV_Assert(img.type() == CV_8UC3 && mask.type() == CV_8UC1 &&
+              img.size() == mask.size());
+    labels.create(img.size(), CV_8UC1);
+
+    int stripe_count =
+        std::clamp(img.rows / kMinStripeRows, 1, pool.GetConcurrency());
+    auto stripe_begin = [&](int k) { return img.rows * k / stripe_count; };
+    stripe_runs_.resize(stripe_count);
+    pool.ParallelFor(stripe_count, [&](int k) {
+        int y0 = stripe_begin(k);
+        int y1 = stripe_begin(k + 1);
+        cv::Mat stripe_labels = labels.rowRange(y0, y1);
+        Label(img.rowRange(y0, y1), mask.rowRange(y0, y1), stripe_labels);
+        ScanRuns(labels, y0, y1, stripe_runs_[k]);
+    });
+
+    // concatenate the stripes and join the two rows at every boundary
+    runs_.clear();
+    size_t last_row_begin = 0;
+    size_t last_row_end = 0;
+    for (int k = 0; k < stripe_count; ++k) {
+        size_t base = runs_.size();
+        for (Run run : stripe_runs_[k]) {
+            run.parent += static_cast<int>(base);
+            runs_.push_back(run);
+        }
+        size_t first_row_end = base;
+        while (first_row_end < runs_.size() &&
+               runs_[first_row_end].y == stripe_begin(k)) {
+            ++first_row_end;
+        }
+        JoinRows(runs_, last_row_begin, last_row_end, base, first_row_end);
+
+        last_row_end = runs_.size();
+        last_row_begin = last_row_end;
+        while (last_row_begin > base &&
+               runs_[last_row_begin - 1].y == stripe_begin(k + 1) - 1) {
+            --last_row_begin;
+        }
+    }
+    return CollectBlobs(offset, min_width, min_area);
+}
+
+void NoteLabeler::ScanRuns(const cv::Mat& labels, int y_begin, int y_end,
+                           std::vector<Run>& runs) {
+    runs.clear();
+    size_t prev_begin = 0;
+    size_t prev_end = 0;
+    for (int y = y_begin; y < y_end; ++y) {
+        const uchar* row = labels.ptr<uchar>(y);
+        size_t cur_begin = runs.size();
+        int x = 0;
+        while (x < labels.cols) {
+            uint8_t label = row[x];
+            if (label == 0) {
+                ++x;
+                continue;
+            }
+            int x0 = x;
+            while (x < labels.cols && row[x] == label) ++x;
+            int idx = static_cast<int>(runs.size());
+            runs.push_back(Run{y, x0, x, label, idx});
+        }
+        JoinRows(runs, prev_begin, prev_end, cur_begin, runs.size());
+        prev_begin = cur_begin;
+        prev_end = runs.size();
+    }
+}
+
+void NoteLabeler::JoinRows(std::vector<Run>& runs, size_t prev_begin,
+                           size_t prev_end, size_t cur_begin, size_t cur_end) {
+    size_t p = prev_begin;
+    for (size_t c = cur_begin; c < cur_end; ++c) {
+        const Run& run = runs[c];
+        // 8-connectivity: touching runs of the previous row cover
+        // [x0 - 1, x1] inclusive
+        while (p < prev_end && runs[p].x1 < run.x0) ++p;
+        for (size_t q = p; q < prev_end && runs[q].x0 <= run.x1; ++q) {
+            if (runs[q].label == run.label) {
+                Union(runs, static_cast<int>(c), static_cast<int>(q));
+            }
+        }
+    }
+}
+
+const std::vector<NoteBlob>& NoteLabeler::CollectBlobs(cv::Point offset,
+                                                       int min_width,
+                                                       int min_area) {
+    stats_.clear();
+    blobs_.clear();
+    root_blob_.assign(runs_.size(), -1);
+    for (int i = 0; i < static_cast<int>(runs_.size()); ++i) {
+        const Run& run = runs_[i];
+        int& stats_index = root_blob_[FindRoot(runs_, i)];
+        if (stats_index == -1) {
+            stats_index = static_cast<int>(stats_.size());
+            stats_.push_back(BlobStats{run.label, cv::Rect(), 0, 0, 0});
+        }
+        BlobStats& stats = stats_[stats_index];
+        int len = run.x1 - run.x0;
+        stats.box |= cv::Rect(run.x0, run.y, len, 1);
+        stats.area += len;
+        // sum of x over [x0, x1)
+        stats.sum_x += static_cast<int64_t>(run.x0 + run.x1 - 1) * len / 2;
+        stats.sum_y += static_cast<int64_t>(run.y) * len;
+    }
+
+    for (const auto& stats : stats_) {
+        if (stats.box.width < min_width || stats.area < min_area) {
+            continue;
+        }
+        cv::Point2d centroid(
+            static_cast<double>(stats.sum_x) / stats.area + 0.5 + offset.x,
+            static_cast<double>(stats.sum_y) / stats.area + 0.5 + offset.y);
+        blobs_.push_back(NoteBlob{static_cast<NoteColor>(stats.label - 1),
+                                  stats.box + offset, stats.area, centroid});
+    }
+    std::sort(blobs_.begin(), blobs_.end(),
+              [](const NoteBlob& lhs, const NoteBlob& rhs) {
+                  return lhs.box.br().y > rhs.box.br().y;
+              });
+    return blobs_;
+}
+
+int NoteLabeler::FindRoot(std::vector<Run>& runs, int i) {
+    while (runs[i].parent != i) {
+        runs[i].parent = runs[runs[i].parent].parent;
+        i = runs[i].parent;
+    }
+    return i;
+}
+
+void NoteLabeler::Union(std::vector<Run>& runs, int a, int b) {
+    a = FindRoot(runs, a);
+    b = FindRoot(runs, b);
+    if (a < b) {
+        runs[b].parent = a;
+    } else if (b < a) {
+        runs[a].parent = b;
+    }
+}
+
+} // namespace psh
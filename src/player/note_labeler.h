@@ -0,0 +1,94 @@
+#pragma once
+
+#ifndef PSH_PLAYER_NOTE_LABELER_H_
+#define PSH_PLAYER_NOTE_LABELER_H_
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include "common/thread_pool.h"
+#include "player/auto_play_constant.h"
+
+namespace psh {
+
+struct NoteBlob {
+    NoteColor color;
+    cv::Rect box;
+    int area;             // pixel count
+    cv::Point2d centroid; // pixel (x, y) covers [x, x + 1) x [y, y + 1)
+};
+
+// Classifies pixels against all kNoteColors in one pass and groups them into
+// 8-connected blobs of the same color with their stats.
+class NoteLabeler {
+public:
+    static constexpr int kColorCount = static_cast<int>(NoteColor::Count);
+    static constexpr int kMinStripeRows = 16;
+
+    explicit NoteLabeler(int delta = kTapColorDelta);
+    NoteLabeler(const NoteLabeler&) = default;
+    NoteLabeler(NoteLabeler&&) = default;
+
+    // labels: CV_8UC1, NoteColor + 1 for matched pixels, 0 otherwise.
+    void Label(const cv::Mat& img, const cv::Mat& mask, cv::Mat& labels) const;
+
+    // Blobs narrower than min_width or smaller than min_area are skipped.
+    // Blobs are ordered bottom-most first, boxes and centroids are shifted by
+    // offset.
+    const std::vector<NoteBlob>& FindBlobs(const cv::Mat& labels,
+                                           cv::Point offset = {},
+                                           int min_width = 0,
+                                           int min_area = 0);
+    // Label and FindBlobs with the rows split into stripes on pool, blobs
+    // crossing stripe boundaries are merged.
+    const std::vector<NoteBlob>& FindBlobs(const cv::Mat& img,
+                                           const cv::Mat& mask,
+                                           cv::Mat& labels, ThreadPool& pool,
+                                           cv::Point offset = {},
+                                           int min_width = 0,
+                                           int min_area = 0);
+
+private:
+    struct Run {
+        int y;
+        int x0;
+        int x1;
+        uint8_t label;
+        int parent;
+    };
+
+    struct BlobStats {
+        uint8_t label;
+        cv::Rect box;
+        int area;
+        int64_t sum_x;
+        int64_t sum_y;
+    };
+
+    static void ScanRuns(const cv::Mat& labels, int y_begin, int y_end,
+                         std::vector<Run>& runs);
+    static void JoinRows(std::vector<Run>& runs, size_t prev_begin,
+                         size_t prev_end, size_t cur_begin, size_t cur_end);
+    static int FindRoot(std::vector<Run>& runs, int i);
+    static void Union(std::vector<Run>& runs, int a, int b);
+    const std::vector<NoteBlob>& CollectBlobs(cv::Point offset, int min_width,
+                                              int min_area);
+
+    // per-channel bit sets of the colors a channel value is close to
+    std::array<std::array<uint8_t, 256>, 3> channel_lut_{};
+    // color bit set -> label
+    std::array<uint8_t, 1 << kColorCount> bits_to_label_{};
+
+    std::vector<Run> runs_;
+    std::vector<std::vector<Run>> stripe_runs_;
+    std::vector<int> root_blob_;
+    std::vector<BlobStats> stats_;
+    std::vector<NoteBlob> blobs_;
+};
+
+} // namespace psh
+
+#endif // !PSH_PLAYER_NOTE_LABELER_H_
@@ -1,5 +1,7 @@
 #include "player/note_time_estimator.h"
 
+#include <algorithm>
+
 #include <spdlog/spdlog.h>
 
 #include "common/time_utils.h"
@@ -99,6 +101,21 @@ int NoteTimeEstimator::EstimateHitTime(int pos_y) {
     return (*delay_lookup_)[pos_y];
 }
 
+double NoteTimeEstimator::EstimateHitTime(double pos_y) {
+    pos_y = std::clamp(pos_y, 0.0, kDelayLoopupSize - 1.0);
+    int y0 = std::min(static_cast<int>(pos_y), kDelayLoopupSize - 2);
+    double t = pos_y - y0;
+    return (*delay_lookup_)[y0] * (1.0 - t) + (*delay_lookup_)[y0 + 1] * t;
+}
+
+int NoteTimeEstimator::EstimatePosY(int delay_ms) {
+    // delays decrease towards the hit line
+    auto it = std::partition_point(delay_lookup_->begin(), delay_lookup_->end(),
+                                   [delay_ms](int d) { return d > delay_ms; });
+    return static_cast<int>(
+        std::min<ptrdiff_t>(it - delay_lookup_->begin(), kDelayLoopupSize - 1));
+}
+
 void NoteTimeEstimator::SetSpeedFactor(SpeedFactor speed_factor) {
     delay_lookup_ = &GetLookupTable(speed_factor);
 }
@@ -28,6 +28,10 @@ public:
     NoteTimeEstimator(NoteTimeEstimator&&) = default;
 
     int EstimateHitTime(int pos_y);
+    // interpolates between the rows around pos_y
+    double EstimateHitTime(double pos_y);
+    // inverse of EstimateHitTime, the y a note is at delay_ms before its hit
+    int EstimatePosY(int delay_ms);
     void SetSpeedFactor(SpeedFactor speed_factor);
 
 private:
@@ -0,0 +1,181 @@
+#include "player/note_tracker.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <spdlog/spdlog.h>
+
+namespace psh {
+
+void NoteTracker::Update(
+    int64_t time_ms,
+    const std::vector<std::pair<NoteColor, std::vector<Note>>>& found,
+    std::vector<NoteUpdate>& updates) {
+    for (const auto& [color, notes] : found) {
+        auto& tracks = tracks_[static_cast<int>(color)];
+        for (auto& track : tracks) {
+            Predict(track, time_ms);
+        }
+
+        lane_index_.resize(tracks.size());
+        for (int i = 0; i < static_cast<int>(tracks.size()); ++i) {
+            lane_index_[i] = i;
+        }
+        std::sort(lane_index_.begin(), lane_index_.end(), [&](int a, int b) {
+            return tracks[a].note.hit_pos.x < tracks[b].note.hit_pos.x;
+        });
+        matched_.assign(tracks.size(), 0);
+
+        std::vector<Note> unmatched;
+        for (const auto& note : notes) {
+            auto it = std::lower_bound(
+                lane_index_.begin(), lane_index_.end(),
+                note.hit_pos.x - kMinNoteDX, [&](int i, int x) {
+                    return tracks[i].note.hit_pos.x <= x;
+                });
+            double remain_ms =
+                static_cast<double>(note.hit_time_ms - time_ms);
+            int best = -1;
+            double best_dist = 0;
+            for (; it != lane_index_.end() &&
+                   tracks[*it].note.hit_pos.x < note.hit_pos.x + kMinNoteDX;
+                 ++it) {
+                const NoteTrack& track = tracks[*it];
+                if (matched_[*it]) {
+                    continue;
+                }
+                double var = track.cov[0][0] + kMeasureVar;
+                double diff = remain_ms - track.remain_ms;
+                double gate = std::max<double>(kMinNoteDT,
+                                               kGateSigma * std::sqrt(var));
+                if (std::abs(diff) >= gate) {
+                    continue;
+                }
+                double dist = diff * diff / var;
+                if (best == -1 || dist < best_dist) {
+                    best = *it;
+                    best_dist = dist;
+                }
+            }
+            if (best == -1) {
+                unmatched.push_back(note);
+            } else {
+                matched_[best] = 1;
+                Correct(tracks[best], note, time_ms);
+            }
+        }
+
+        for (int i = 0; i < static_cast<int>(tracks.size()); ++i) {
+            NoteTrack& track = tracks[i];
+            track.missed = matched_[i] ? 0 : track.missed + 1;
+            if (!track.touched &&
+                (IsReady(track) ||
+                 (track.missed > kMaxMissed &&
+                  track.count > min_sample_count_))) {
+                track.touched = true;
+                track.touched_note = track.note;
+                updates.push_back({track.id, false, track.note});
+            } else if (track.touched && matched_[i] &&
+                       (std::abs(track.note.hit_time_ms -
+                                 track.touched_note.hit_time_ms) >= kAmendMs ||
+                        track.note.hold != track.touched_note.hold ||
+                        track.note.is_slide != track.touched_note.is_slide)) {
+                track.touched_note = track.note;
+                updates.push_back({track.id, true, track.note});
+            } else if (!track.touched && track.missed > kMaxMissed) {
+                spdlog::info("Note has too few samples: {}", track.count);
+            }
+        }
+        tracks.erase(std::remove_if(tracks.begin(), tracks.end(),
+                                    [](const NoteTrack& track) {
+                                        return track.missed > kMaxMissed;
+                                    }),
+                     tracks.end());
+
+        for (const auto& note : unmatched) {
+            // clang-format off
+            NoteTrack track;
+            track.id             = next_id_++;
+            track.note           = note;
+            track.remain_ms      = static_cast<double>(note.hit_time_ms - time_ms);
+            track.rate           = -1.0;
+            track.cov[0][0]      = kMeasureVar;
+            track.cov[0][1]      = 0.0;
+            track.cov[1][0]      = 0.0;
+            track.cov[1][1]      = kRateVar;
+            track.update_time_ms = time_ms;
+            // clang-format on
+            tracks.push_back(track);
+        }
+    }
+}
+
+std::vector<Note> NoteTracker::GetTrackedNotes() const {
+    std::vector<Note> notes;
+    for (const auto& tracks : tracks_) {
+        for (const auto& track : tracks) {
+            notes.push_back(track.note);
+        }
+    }
+    return notes;
+}
+
+void NoteTracker::Clear() {
+    for (auto& tracks : tracks_) {
+        tracks.clear();
+    }
+}
+
+void NoteTracker::Predict(NoteTrack& track, int64_t time_ms) const {
+    double dt = static_cast<double>(time_ms - track.update_time_ms);
+    if (dt <= 0) {
+        return;
+    }
+    auto& p = track.cov;
+    track.remain_ms += track.rate * dt;
+    // P = F P F^T + Q with F = [1 dt; 0 1]
+    double p00 = p[0][0] + dt * (p[0][1] + p[1][0]) + dt * dt * p[1][1];
+    double p01 = p[0][1] + dt * p[1][1];
+    double p10 = p[1][0] + dt * p[1][1];
+    p[0][0] = p00 + kRemainNoise * dt;
+    p[0][1] = p01;
+    p[1][0] = p10;
+    p[1][1] += kRateNoise * dt;
+    track.update_time_ms = time_ms;
+}
+
+void NoteTracker::Correct(NoteTrack& track, const Note& note,
+                          int64_t time_ms) const {
+    auto& p = track.cov;
+    double innovation =
+        static_cast<double>(note.hit_time_ms - time_ms) - track.remain_ms;
+    double s = p[0][0] + kMeasureVar;
+    double k0 = p[0][0] / s;
+    double k1 = p[1][0] / s;
+    track.remain_ms += k0 * innovation;
+    track.rate = std::clamp(track.rate + k1 * innovation, -2.0, -0.5);
+    double p00 = (1 - k0) * p[0][0];
+    double p01 = (1 - k0) * p[0][1];
+    double p10 = p[1][0] - k1 * p[0][0];
+    double p11 = p[1][1] - k1 * p[0][1];
+    p[0][0] = p00;
+    p[0][1] = p01;
+    p[1][0] = p10;
+    p[1][1] = p11;
+
+    Note prev = track.note;
+    track.note = note;
+    track.note.is_slide |= prev.is_slide;
+    track.note.hit_pos.x =
+        (prev.hit_pos.x * track.count + note.hit_pos.x) / (track.count + 1);
+    track.note.hit_time_ms =
+        time_ms + std::llround(track.remain_ms / -track.rate);
+    ++track.count;
+}
+
+bool NoteTracker::IsReady(const NoteTrack& track) const {
+    return track.count > min_sample_count_ &&
+           track.HitTimeVariance() <= kReadyVar;
+}
+
+} // namespace psh
@@ -0,0 +1,83 @@
+#pragma once
+
+#ifndef PSH_PLAYER_NOTE_TRACKER_H_
+#define PSH_PLAYER_NOTE_TRACKER_H_
+
+#include <array>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "player/auto_play_constant.h"
+#include "player/note_finder.h"
+
+namespace psh {
+
+// Filters the hit time of every note over the frames it is seen in. The
+// state is the remaining time until the hit and its rate of change (-1 when
+// the speed factor matches the delay table), measured by each frame's
+// EstimateHitTime.
+struct NoteTrack {
+    int id;
+    Note note;          // latest detection, hit_time_ms is the filtered one
+    Note touched_note;  // note last released for touching
+    double remain_ms;   // remaining time at update_time_ms
+    double rate;        // d(remain_ms) / dt
+    double cov[2][2];
+    int64_t update_time_ms;
+    int count = 1;
+    int missed = 0;
+    bool touched = false;
+
+    double HitTimeVariance() const { return cov[0][0]; }
+};
+
+struct NoteUpdate {
+    int id;
+    bool amend; // refines a note released before under the same id
+    Note note;
+};
+
+// Associates detections with tracks by gated nearest neighbour on a per-color
+// index sorted by lane x, and releases a note for touching once its hit time
+// variance is low enough instead of waiting for it to leave the check area.
+class NoteTracker {
+public:
+    // clang-format off
+    static constexpr double kMeasureVar   = 25.0;   // ms^2
+    static constexpr double kRateVar      = 0.01;
+    static constexpr double kRemainNoise  = 0.01;   // ms^2 per ms
+    static constexpr double kRateNoise    = 1e-6;   // per ms
+    static constexpr double kReadyVar     = 16.0;   // ms^2
+    static constexpr double kGateSigma    = 3.0;
+    static constexpr int    kMaxMissed    = 2;
+    static constexpr int    kAmendMs      = 1;      // ms
+    // clang-format on
+
+    explicit NoteTracker(int min_sample_count)
+        : min_sample_count_(min_sample_count) {}
+
+    // Notes to touch now are appended to updates once, later refinements of
+    // their hit time or type are appended as amendments with the same id.
+    void Update(int64_t time_ms,
+                const std::vector<std::pair<NoteColor, std::vector<Note>>>& found,
+                std::vector<NoteUpdate>& updates);
+    std::vector<Note> GetTrackedNotes() const;
+    void Clear();
+
+private:
+    void Predict(NoteTrack& track, int64_t time_ms) const;
+    void Correct(NoteTrack& track, const Note& note, int64_t time_ms) const;
+    bool IsReady(const NoteTrack& track) const;
+
+    int min_sample_count_;
+    int next_id_ = 0;
+    std::array<std::vector<NoteTrack>, static_cast<int>(NoteColor::Count)>
+        tracks_;
+    std::vector<int> lane_index_;
+    std::vector<int8_t> matched_;
+};
+
+} // namespace psh
+
+#endif // !PSH_PLAYER_NOTE_TRACKER_H_
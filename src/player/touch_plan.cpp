@@ -0,0 +1,203 @@
+#include "player/touch_plan.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <spdlog/spdlog.h>
+
+#include "common/mapped_file.h"
+#include "player/auto_play_constant.h"
+
+namespace MMW = MikuMikuWorld;
+
+namespace psh {
+
+TouchPlan BuildTouchPlan(const ScoreTouch& score_touch,
+                         const HrLine& hit_line) {
+    constexpr double kLaneCount = 12.0;
+    TouchPlan plan;
+    plan.streams.reserve(score_touch.notes.size() + score_touch.holds.size());
+    for (const auto& note : score_touch.notes) {
+        cv::Point pos = hit_line.PosOf(note.lane / kLaneCount);
+        TouchTaskStream tasks;
+        if (note.flick == MMW::FlickType::None) {
+            tasks.AddTap(note.delay_ms, pos, kTapDurationMs);
+        } else {
+            tasks.AddSlide(note.delay_ms + kSlideDelayMs, pos,
+                           pos + cv::Point{0, kSlideMoveDY}, kSlideDurationMs,
+                           1.0, 1.0);
+        }
+        plan.streams.push_back(std::move(tasks));
+        plan.first_note_ms = std::min(plan.first_note_ms, note.delay_ms);
+    }
+    for (const auto& hold : score_touch.holds) {
+        TouchTaskStream tasks;
+        tasks.SetPriority(TouchPriority::kHold);
+        if (hold.start.flick == MMW::FlickType::None) {
+            tasks.AddTask(hold.start.delay_ms, TouchAction::Down,
+                          hit_line.PosOf(hold.start.lane / kLaneCount));
+        } else {
+            tasks.AddSlide(hold.start.delay_ms + kSlideDelayMs,
+                           hit_line.PosOf(hold.start.lane / kLaneCount) -
+                               cv::Point{0, kSlideMoveDY},
+                           hit_line.PosOf(hold.start.lane / kLaneCount),
+                           kSlideDurationMs, 1.0, 1.0, true, false);
+        }
+        for (const auto& segment : hold.segments) {
+            tasks.AddMotion(segment.begin_ms,
+                            hit_line.PosOf(segment.begin_lane / kLaneCount),
+                            hit_line.PosOf(segment.end_lane / kLaneCount),
+                            segment.end_ms - segment.begin_ms,
+                            segment.slope_in, segment.slope_out);
+        }
+        if (hold.end.flick == MMW::FlickType::None) {
+            tasks.AddTask(hold.end.delay_ms, TouchAction::Up, {});
+        } else {
+            tasks.AddSlide(hold.end.delay_ms + kHoldEndSlideDelayMs,
+                           hit_line.PosOf(hold.end.lane / kLaneCount),
+                           hit_line.PosOf(hold.end.lane / kLaneCount) +
+                               cv::Point{0, kSlideMoveDY},
+                           kSlideDurationMs, 1.0, 1.0, false, true);
+        }
+        plan.streams.push_back(std::move(tasks));
+        plan.first_note_ms = std::min(plan.first_note_ms, hold.start.delay_ms);
+    }
+    return plan;
+}
+
+uint64_t HashTouchPlanBytes(const void* data, size_t size, uint64_t seed) {
+    const auto* bytes = static_cast<const uint8_t*>(data);
+    uint64_t hash = seed;
+    for (size_t i = 0; i < size; ++i) {
+        hash = (hash ^ bytes[i]) * 0x100000001b3;
+    }
+    return hash;
+}
+
+uint64_t HashChartFile(const std::filesystem::path& path) {
+    MappedFile file;
+    if (!file.Open(path)) {
+        return 0;
+    }
+    return HashTouchPlanBytes(file.Data(), file.Size());
+}
+
+uint64_t GetTouchPlanGeometryHash(const HrLine& hit_line) {
+    const int32_t values[] = {static_cast<int32_t>(kTouchPlanVersion),
+                              hit_line.pos.x,
+                              hit_line.pos.y,
+                              hit_line.length,
+                              kTapDurationMs,
+                              kSlideMoveDY,
+                              kSlideDurationMs,
+                              kSlideDelayMs,
+                              kHoldEndSlideDelayMs};
+    return HashTouchPlanBytes(values, sizeof(values));
+}
+
+std::optional<TouchPlan> LoadTouchPlan(const std::filesystem::path& path,
+                                       uint64_t chart_hash,
+                                       uint64_t geometry_hash) {
+    MappedFile file;
+    if (!file.Open(path) || file.Size() < sizeof(TouchPlanHeader)) {
+        return std::nullopt;
+    }
+    const auto& header = *reinterpret_cast<const TouchPlanHeader*>(file.Data());
+    if (std::memcmp(header.magic, kTouchPlanMagic, sizeof(header.magic)) !=
+            0 ||
+        header.version != kTouchPlanVersion ||
+        header.chart_hash != chart_hash ||
+        header.geometry_hash != geometry_hash ||
+        file.Size() != sizeof(TouchPlanHeader) +
+                           header.stream_count * sizeof(TouchPlanStream) +
+                           header.task_count * sizeof(TouchPlanTask)) {
+        return std::nullopt;
+    }
+    const auto* streams = reinterpret_cast<const TouchPlanStream*>(
+        file.Data() + sizeof(TouchPlanHeader));
+    const auto* tasks =
+        reinterpret_cast<const TouchPlanTask*>(streams + header.stream_count);
+
+    TouchPlan plan;
+    plan.first_note_ms = header.first_note_ms;
+    plan.streams.reserve(header.stream_count);
+    for (uint32_t i = 0; i < header.stream_count; ++i) {
+        const TouchPlanStream& stream = streams[i];
+        if (stream.first_task > header.task_count ||
+            stream.task_count > header.task_count - stream.first_task) {
+            spdlog::warn("Broken touch plan: {}", path.string());
+            return std::nullopt;
+        }
+        std::vector<TouchTask> stream_tasks;
+        stream_tasks.reserve(stream.task_count);
+        for (uint32_t j = 0; j < stream.task_count; ++j) {
+            const TouchPlanTask& task = tasks[stream.first_task + j];
+            stream_tasks.push_back(TouchTask{
+                static_cast<TouchAction>(task.action),
+                {task.x, task.y},
+                task.execute_time_ns,
+                task.duration_ns,
+                {task.from_x, task.from_y},
+                task.slope_in,
+                task.slope_out});
+        }
+        plan.streams.emplace_back(std::move(stream_tasks));
+        plan.streams.back().SetPriority(
+            static_cast<TouchPriority>(stream.priority));
+    }
+    return plan;
+}
+
+bool SaveTouchPlan(const std::filesystem::path& path, const TouchPlan& plan,
+                   uint64_t chart_hash, uint64_t geometry_hash) {
+    size_t task_count = 0;
+    for (const auto& stream : plan.streams) {
+        task_count += stream.GetTasks().size();
+    }
+    size_t size = sizeof(TouchPlanHeader) +
+                  plan.streams.size() * sizeof(TouchPlanStream) +
+                  task_count * sizeof(TouchPlanTask);
+    MappedFile file;
+    if (!file.Create(path, size)) {
+        spdlog::error("Failed to create touch plan: {}", path.string());
+        return false;
+    }
+    auto* header = reinterpret_cast<TouchPlanHeader*>(file.Data());
+    auto* streams = reinterpret_cast<TouchPlanStream*>(
+        file.Data() + sizeof(TouchPlanHeader));
+    auto* tasks =
+        reinterpret_cast<TouchPlanTask*>(streams + plan.streams.size());
+
+    uint32_t task_index = 0;
+    for (const auto& stream : plan.streams) {
+        *streams++ = TouchPlanStream{
+            task_index, static_cast<uint32_t>(stream.GetTasks().size()),
+            static_cast<uint32_t>(stream.GetPriority()), 0};
+        for (const auto& task : stream.GetTasks()) {
+            tasks[task_index++] = TouchPlanTask{
+                task.execute_time_ns,
+                task.duration_ns,
+                task.pos.x,
+                task.pos.y,
+                task.from.x,
+                task.from.y,
+                task.slope_in,
+                task.slope_out,
+                static_cast<uint32_t>(task.action),
+                0};
+        }
+    }
+
+    TouchPlanHeader completed{};
+    completed.version = kTouchPlanVersion;
+    completed.stream_count = static_cast<uint32_t>(plan.streams.size());
+    completed.task_count = task_index;
+    completed.first_note_ms = plan.first_note_ms;
+    completed.chart_hash = chart_hash;
+    completed.geometry_hash = geometry_hash;
+    *header = completed;
+    std::memcpy(header->magic, kTouchPlanMagic, sizeof(header->magic));
+    return true;
+}
+
+} // namespace psh
@@ -0,0 +1,102 @@
+#pragma once
+
+#ifndef PSH_PLAYER_TOUCH_PLAN_H_
+#define PSH_PLAYER_TOUCH_PLAN_H_
+
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <vector>
+
+#include "common/hr_line.h"
+#include "sus/score_touch.h"
+#include "touch/i_touch.h"
+
+namespace psh {
+
+// Touch plan file layout:
+//   TouchPlanHeader
+//   TouchPlanStream streams[stream_count]
+//   TouchPlanTask tasks[task_count]
+// The magic is written last, a file without it was never completed.
+struct TouchPlanHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t stream_count;
+    uint32_t task_count;
+    int32_t first_note_ms;
+    uint64_t chart_hash;    // of the .sus file
+    uint64_t geometry_hash; // see GetTouchPlanGeometryHash
+    uint32_t reserved[6];
+};
+static_assert(sizeof(TouchPlanHeader) == 64,
+              "TouchPlanHeader must be 64 bytes");
+
+struct TouchPlanStream {
+    uint32_t first_task;
+    uint32_t task_count;
+    uint32_t priority;
+    uint32_t reserved;
+};
+static_assert(sizeof(TouchPlanStream) == 16,
+              "TouchPlanStream must be 16 bytes");
+
+struct TouchPlanTask {
+    int64_t execute_time_ns;
+    int64_t duration_ns;
+    int32_t x;
+    int32_t y;
+    int32_t from_x;
+    int32_t from_y;
+    float slope_in;
+    float slope_out;
+    uint32_t action;
+    uint32_t reserved;
+};
+static_assert(sizeof(TouchPlanTask) == 48, "TouchPlanTask must be 48 bytes");
+
+inline constexpr char kTouchPlanMagic[8] = "PSHPLAN";
+// Bump on any change to the plan output, including the tick to time
+// conversion of ScoreToTouch, so cached plans are rebuilt.
+inline constexpr uint32_t kTouchPlanVersion = 2;
+inline constexpr char kTouchPlanExtension[] = ".pshplan";
+
+// Every touch stream of a chart, ready for TouchExecutor::Execute.
+struct TouchPlan {
+    std::vector<TouchTaskStream> streams;
+    int first_note_ms = INT_MAX; // of the taps and hold starts
+};
+
+// Changing what this or ScoreToTouch produces must bump kTouchPlanVersion.
+TouchPlan BuildTouchPlan(const ScoreTouch& score_touch,
+                         const HrLine& hit_line);
+
+// FNV-1a, chain calls through seed
+uint64_t HashTouchPlanBytes(const void* data, size_t size,
+                            uint64_t seed = 0xcbf29ce484222325);
+// 0 if the file cannot be read
+uint64_t HashChartFile(const std::filesystem::path& path);
+// Covers the hit line and every constant BuildTouchPlan depends on.
+uint64_t GetTouchPlanGeometryHash(const HrLine& hit_line);
+
+// Empty when the file is missing, broken or built for another chart or
+// geometry.
+std::optional<TouchPlan> LoadTouchPlan(const std::filesystem::path& path,
+                                       uint64_t chart_hash,
+                                       uint64_t geometry_hash);
+bool SaveTouchPlan(const std::filesystem::path& path, const TouchPlan& plan,
+                   uint64_t chart_hash, uint64_t geometry_hash);
+
+// A chart converted while the song is still being selected, see
+// SusLoader::SusResult::prepared. Only plain data, the play builds its own
+// executor from the plan, so this may outlive the player that asked for it.
+struct PreparedChart {
+    HrLine hit_line; // a play with another hit line has to prepare again
+    TouchPlan plan;
+};
+
+} // namespace psh
+
+#endif // !PSH_PLAYER_TOUCH_PLAN_H_
\ No newline at end of file
@@ -0,0 +1,80 @@
+#include "player/track_geometry.h"
+
+#include <mutex>
+#include <utility>
+
+namespace psh {
+
+bool TrackConfig::operator==(const TrackConfig& other) const {
+    return upper_len == other.upper_len && lower_len == other.lower_len &&
+           height == other.height && hit_line_y == other.hit_line_y &&
+           check_upper_y == other.check_upper_y &&
+           check_lower_y == other.check_lower_y && dx == other.dx &&
+           dy == other.dy;
+}
+
+bool TrackConfig::operator!=(const TrackConfig& other) const {
+    return !(*this == other);
+}
+
+std::shared_ptr<const TrackGeometry> TrackGeometry::Get(
+    const TrackConfig& tc) {
+    static std::mutex mutex;
+    static std::vector<std::shared_ptr<const TrackGeometry>> cache;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const auto& geometry : cache) {
+        if (geometry->GetConfig() == tc) {
+            return geometry;
+        }
+    }
+    cache.push_back(std::make_shared<const TrackGeometry>(tc));
+    return cache.back();
+}
+
+TrackGeometry::TrackGeometry(const TrackConfig& tc) : tc_(tc) {
+    hit_line_ = CalcLineOf(tc_, tc_.hit_line_y);
+    for (int y = 0; y <= tc_.height; ++y) {
+        const HrLine& line = lines_.emplace_back(CalcLineOf(tc_, y));
+        hit_scale_q16_.push_back(static_cast<int32_t>(
+            (static_cast<int64_t>(hit_line_.length) << 16) / line.length));
+    }
+
+    auto build_mask = [this](int upper_y, int lower_y, cv::Rect& area,
+                             cv::Mat& mask) {
+        HrLine upper = LineOf(upper_y);
+        HrLine lower = LineOf(lower_y);
+        area = cv::Rect(lower.pos.x, upper.pos.y, lower.length,
+                        lower.pos.y - upper.pos.y);
+        mask = cv::Mat::zeros(area.height, area.width, CV_8UC1);
+        std::vector<std::vector<cv::Point>> mask_pts = {
+            {upper.Left() - area.tl(), upper.Right() - area.tl(),
+             lower.Right() - area.tl(), lower.Left() - area.tl()}};
+        cv::fillPoly(mask, mask_pts, cv::Scalar(255));
+    };
+    build_mask(0, tc_.height, track_area_, track_mask_);
+    build_mask(tc_.check_upper_y, tc_.check_lower_y, check_area_, check_mask_);
+}
+
+HrLine TrackGeometry::LineOf(int y) const {
+    if (y < 0 || y >= static_cast<int>(lines_.size())) {
+        return CalcLineOf(tc_, y);
+    }
+    return lines_[y];
+}
+
+cv::Point TrackGeometry::ProjectToHitLine(cv::Point p) const {
+    if (p.y < 0 || p.y >= static_cast<int>(lines_.size())) {
+        return hit_line_.PosOf(CalcLineOf(tc_, p.y), p);
+    }
+    int64_t dx = p.x - lines_[p.y].pos.x;
+    return hit_line_.pos +
+           cv::Point{static_cast<int>((dx * hit_scale_q16_[p.y]) >> 16), 0};
+}
+
+HrLine TrackGeometry::CalcLineOf(const TrackConfig& tc, int y) {
+    int a = (tc.lower_len - tc.upper_len) * (tc.height - y) / tc.height;
+    return HrLine{cv::Point{tc.dx + a / 2, y}, tc.lower_len - a};
+}
+
+} // namespace psh
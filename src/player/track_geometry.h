@@ -0,0 +1,68 @@
+#pragma once
+
+#ifndef PSH_PLAYER_TRACK_GEOMETRY_H_
+#define PSH_PLAYER_TRACK_GEOMETRY_H_
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include "common/hr_line.h"
+
+namespace psh {
+
+// clang-format off
+struct TrackConfig {
+    int upper_len     = 59;
+    int lower_len     = 1260;
+    int height        = 720; 
+    int hit_line_y    = 567;
+    int check_upper_y = 0;
+    int check_lower_y = 270;
+    int dx            = 10;
+    int dy            = 0;
+
+    bool operator==(const TrackConfig& other) const;
+    bool operator!=(const TrackConfig& other) const;
+};
+// clang-format on
+
+// Per-row track lines, hit line projection and the track/check masks of a
+// TrackConfig. Instances are immutable and shared through Get.
+class TrackGeometry {
+public:
+    static std::shared_ptr<const TrackGeometry> Get(const TrackConfig& tc);
+
+    explicit TrackGeometry(const TrackConfig& tc);
+
+    HrLine LineOf(int y) const;
+    // moves p along the track perspective onto the hit line
+    cv::Point ProjectToHitLine(cv::Point p) const;
+
+    const TrackConfig& GetConfig() const { return tc_; }
+    const HrLine& GetHitLine() const { return hit_line_; }
+    const cv::Rect& GetTrackArea() const { return track_area_; }
+    const cv::Rect& GetCheckArea() const { return check_area_; }
+    const cv::Mat& GetTrackMask() const { return track_mask_; }
+    const cv::Mat& GetCheckMask() const { return check_mask_; }
+
+private:
+    static HrLine CalcLineOf(const TrackConfig& tc, int y);
+
+    TrackConfig tc_;
+    // indexed by row, 0 to tc_.height inclusive
+    std::vector<HrLine> lines_;
+    std::vector<int32_t> hit_scale_q16_;
+
+    HrLine hit_line_;
+    cv::Rect track_area_;
+    cv::Rect check_area_;
+    cv::Mat track_mask_;
+    cv::Mat check_mask_;
+};
+
+} // namespace psh
+
+#endif // !PSH_PLAYER_TRACK_GEOMETRY_H_
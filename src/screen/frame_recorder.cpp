@@ -0,0 +1,158 @@
+#include "screen/frame_recorder.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <spdlog/spdlog.h>
+
+namespace psh {
+
+FrameRecorder::~FrameRecorder() { Stop(); }
+
+bool FrameRecorder::Start(const std::filesystem::path& path,
+                          cv::Size display_size, int capacity, cv::Rect roi) {
+    if (IsRecording() || capacity <= 0) {
+        return false;
+    }
+    cv::Rect display_rect({0, 0}, display_size);
+    roi_ = roi.empty() ? display_rect : (roi & display_rect);
+    if (roi_.empty()) {
+        spdlog::error("Recording roi is outside of the display");
+        return false;
+    }
+    display_size_ = display_size;
+
+    RecordingHeader header{};
+    std::memcpy(header.magic, kRecordingMagic, sizeof(header.magic));
+    header.version = kRecordingVersion;
+    header.capacity = static_cast<uint32_t>(capacity);
+    header.display_width = display_size.width;
+    header.display_height = display_size.height;
+    header.roi_x = roi_.x;
+    header.roi_y = roi_.y;
+    header.roi_width = roi_.width;
+    header.roi_height = roi_.height;
+
+    mapped_frames_ = std::min(kInitialFrames, header.capacity);
+    if (!file_.Create(path, GetFrameOffset(header, mapped_frames_))) {
+        spdlog::error("Failed to create recording: {}", path.string());
+        return false;
+    }
+    header_ = reinterpret_cast<RecordingHeader*>(file_.Data());
+    *header_ = header;
+    index_ = reinterpret_cast<int64_t*>(file_.Data() + sizeof(header));
+
+    dropped_.store(0, std::memory_order_relaxed);
+    count_.store(0, std::memory_order_relaxed);
+    run_flag_.store(true, std::memory_order_release);
+    write_thread_ = std::thread(&FrameRecorder::WriteLoop, this);
+    spdlog::info(
+        "Recording started: {}, roi: ({}, {}, {}, {}), {:.1f}MB per frame",
+        path.string(), roi_.x, roi_.y, roi_.width, roi_.height,
+        roi_.area() * 3 / 1048576.0);
+    return true;
+}
+
+void FrameRecorder::Stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        run_flag_.store(false, std::memory_order_release);
+    }
+    cv_.notify_all();
+    if (write_thread_.joinable()) {
+        write_thread_.join();
+        spdlog::info("Recording stopped, recorded: {}, dropped: {}",
+                     GetRecordedCount(), GetDroppedCount());
+    }
+    // drop the mapped but unused tail
+    if (header_ != nullptr) {
+        file_.Resize(GetFrameOffset(*header_, header_->count));
+    }
+    header_ = nullptr;
+    index_ = nullptr;
+    file_.Close();
+}
+
+void FrameRecorder::Push(const Frame& frame) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!run_flag_.load(std::memory_order_acquire)) {
+            return;
+        }
+        if (queue_.size() >= kMaxQueueSize) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        // shares the buffer, the capture ring detaches slots still referenced
+        queue_.push_back(frame);
+    }
+    cv_.notify_one();
+}
+
+uint64_t FrameRecorder::GetRecordedCount() const {
+    return count_.load(std::memory_order_acquire);
+}
+
+size_t FrameRecorder::GetFrameOffset(const RecordingHeader& header,
+                                     size_t index) {
+    size_t frame_bytes = static_cast<size_t>(header.roi_width) *
+                         header.roi_height * 3;
+    return sizeof(RecordingHeader) + sizeof(int64_t) * header.capacity +
+           frame_bytes * index;
+}
+
+void FrameRecorder::WriteLoop() {
+    while (true) {
+        Frame frame;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this]() {
+                return !queue_.empty() ||
+                       !run_flag_.load(std::memory_order_acquire);
+            });
+            if (queue_.empty()) {
+                return;
+            }
+            frame = std::move(queue_.front());
+            queue_.pop_front();
+        }
+        WriteFrame(frame);
+    }
+}
+
+bool FrameRecorder::MapFrames(uint32_t frames) {
+    RecordingHeader header = *header_;
+    if (!file_.Resize(GetFrameOffset(header, frames))) {
+        header_ = nullptr;
+        index_ = nullptr;
+        return false;
+    }
+    header_ = reinterpret_cast<RecordingHeader*>(file_.Data());
+    index_ = reinterpret_cast<int64_t*>(file_.Data() + sizeof(header));
+    mapped_frames_ = frames;
+    return true;
+}
+
+void FrameRecorder::WriteFrame(const Frame& frame) {
+    if (header_ == nullptr || frame.img.type() != CV_8UC3 ||
+        frame.img.size() != display_size_) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    uint32_t count = header_->count;
+    if (count == mapped_frames_ &&
+        (count >= header_->capacity ||
+         !MapFrames(std::min(mapped_frames_ * 2, header_->capacity)))) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    cv::Mat dst(roi_.height, roi_.width, CV_8UC3,
+                file_.Data() + GetFrameOffset(*header_, count));
+    frame.img(roi_).copyTo(dst);
+    index_[count] = frame.capture_time_ms;
+    // readers trust count, bump it only after the frame is complete
+    header_->count = count + 1;
+    count_.store(count + 1, std::memory_order_release);
+}
+
+} // namespace psh
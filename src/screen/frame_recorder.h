@@ -0,0 +1,103 @@
+#pragma once
+
+#ifndef PSH_SCREEN_FRAME_RECORDER_H_
+#define PSH_SCREEN_FRAME_RECORDER_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <thread>
+
+#include <opencv2/opencv.hpp>
+
+#include "common/mapped_file.h"
+#include "screen/i_screen.h"
+
+namespace psh {
+
+// Recording file layout:
+//   RecordingHeader
+//   int64_t capture_time_ms[capacity]
+//   uint8_t frames[capacity][roi_height][roi_width][3] (BGR)
+// The index is sized for capacity frames up front, the frame area grows
+// while recording and ends after the first count frames once stopped.
+struct RecordingHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t capacity;
+    uint32_t count;
+    int32_t display_width;
+    int32_t display_height;
+    int32_t roi_x;
+    int32_t roi_y;
+    int32_t roi_width;
+    int32_t roi_height;
+    uint32_t reserved[5];
+};
+static_assert(sizeof(RecordingHeader) == 64,
+              "RecordingHeader must be 64 bytes");
+
+inline constexpr char kRecordingMagic[8] = "PSHREC";
+inline constexpr uint32_t kRecordingVersion = 1;
+
+// Appends frames handed over by IScreen to a memory-mapped recording. Push
+// only queues a reference to the frame, the copy into the mapping happens on
+// the writer thread.
+class FrameRecorder {
+public:
+    // clang-format off
+    static constexpr size_t kMaxQueueSize    = 8;
+    static constexpr uint32_t kInitialFrames = 256;   // mapped at start
+    // clang-format on
+
+    FrameRecorder() = default;
+    ~FrameRecorder();
+
+    FrameRecorder(const FrameRecorder&) = delete;
+    FrameRecorder& operator=(const FrameRecorder&) = delete;
+
+    // An empty roi records the whole display. At most capacity frames are
+    // recorded, the file only grows with the recorded frames.
+    bool Start(const std::filesystem::path& path, cv::Size display_size,
+               int capacity, cv::Rect roi = {});
+    void Stop();
+    bool IsRecording() const {
+        return run_flag_.load(std::memory_order_acquire);
+    }
+
+    void Push(const Frame& frame);
+
+    uint64_t GetRecordedCount() const;
+    uint64_t GetDroppedCount() const {
+        return dropped_.load(std::memory_order_relaxed);
+    }
+
+    static size_t GetFrameOffset(const RecordingHeader& header, size_t index);
+
+private:
+    void WriteLoop();
+    void WriteFrame(const Frame& frame);
+    bool MapFrames(uint32_t frames);
+
+    MappedFile file_;
+    RecordingHeader* header_ = nullptr;
+    int64_t* index_ = nullptr;
+    uint32_t mapped_frames_ = 0;
+    cv::Size display_size_;
+    cv::Rect roi_;
+
+    std::deque<Frame> queue_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::thread write_thread_;
+    std::atomic_bool run_flag_{false};
+    std::atomic<uint64_t> dropped_{0};
+    std::atomic<uint32_t> count_{0}; // header_ moves when the file grows
+};
+
+} // namespace psh
+
+#endif // !PSH_SCREEN_FRAME_RECORDER_H_
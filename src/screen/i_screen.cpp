@@ -2,22 +2,186 @@
 
 #include <spdlog/spdlog.h>
 
+#include "common/cv_utils.h"
 #include "common/time_utils.h"
+#include "screen/frame_recorder.h"
 
 namespace psh {
 
+IScreen::~IScreen() { StopCapture(); }
+
 Frame IScreen::GetFrame() {
+    if (IsCapturing()) {
+        std::unique_lock<std::mutex> lock(frame_mutex_);
+        frame_cv_.wait(lock, [this]() {
+            return latest_index_ != -1 ||
+                   !capture_flag_.load(std::memory_order_acquire);
+        });
+        if (latest_index_ != -1) {
+            const Frame& latest = frame_ring_[latest_index_];
+            if (latest_seq_ == read_seq_) {
+                ++stats_.duplicate;
+            }
+            if (GetCurrentTimeMs() - latest.capture_time_ms > stale_ms_) {
+                ++stats_.stale;
+            }
+            read_seq_ = latest_seq_;
+            return ReadFrame(latest);
+        }
+    }
     std::lock_guard<std::mutex> lock(frame_mutex_);
-    frame_ = Frame{Capture(), GetCurrentTimeMs()};
-    return frame_;
+    return ReadFrame(PublishFrame(CaptureFrame()));
 }
 
 Frame IScreen::GetFrame(int max_interval_ms) {
+    if (IsCapturing()) {
+        return GetFrame();
+    }
+    std::lock_guard<std::mutex> lock(frame_mutex_);
+    if (latest_index_ != -1 &&
+        GetCurrentTimeMs() - frame_ring_[latest_index_].capture_time_ms <
+            max_interval_ms) {
+        return ReadFrame(frame_ring_[latest_index_]);
+    }
+    return ReadFrame(PublishFrame(CaptureFrame()));
+}
+
+void IScreen::SetCaptureRegions(std::vector<cv::Rect> regions) {
+    std::lock_guard<std::mutex> lock(regions_mutex_);
+    regions_ = std::move(regions);
+}
+
+void IScreen::SetRecorder(std::shared_ptr<FrameRecorder> recorder) {
     std::lock_guard<std::mutex> lock(frame_mutex_);
-    if (GetCurrentTimeMs() - frame_.capture_time_ms >= max_interval_ms) {
-        frame_ = Frame{Capture(), GetCurrentTimeMs()};
+    recorder_ = std::move(recorder);
+}
+
+bool IScreen::StartCapture(int interval_ms, int stale_ms) {
+    if (capture_flag_.exchange(true, std::memory_order_acq_rel)) {
+        return false;
+    }
+    if (capture_thread_.joinable()) {
+        capture_thread_.join();
+    }
+    {
+        std::lock_guard<std::mutex> lock(frame_mutex_);
+        latest_index_ = -1;
+        latest_seq_ = 0;
+        read_seq_ = 0;
+        stats_ = CaptureStats{};
+        capture_interval_ms_ = interval_ms;
+        stale_ms_ = stale_ms;
+    }
+    capture_thread_ = std::thread(&IScreen::CaptureLoop, this);
+    spdlog::info("Capture thread started, interval: {}ms", interval_ms);
+    return true;
+}
+
+void IScreen::StopCapture() {
+    {
+        std::lock_guard<std::mutex> lock(frame_mutex_);
+        capture_flag_.store(false, std::memory_order_release);
+    }
+    frame_cv_.notify_all();
+    if (capture_thread_.joinable()) {
+        capture_thread_.join();
+        auto stats = GetCaptureStats();
+        spdlog::info(
+            "Capture thread stopped, captured: {}, dropped: {}, stale: {}, "
+            "duplicate: {}",
+            stats.captured, stats.dropped, stats.stale, stats.duplicate);
+    }
+}
+
+bool IScreen::WaitForNewFrame(int timeout_ms) {
+    if (!IsCapturing()) {
+        return true;
+    }
+    IClock& clock = GetClock();
+    int64_t deadline_ns = clock.NowNs() + MsToNs(timeout_ms);
+    std::unique_lock<std::mutex> lock(frame_mutex_);
+    while (latest_seq_ == read_seq_ &&
+           capture_flag_.load(std::memory_order_acquire)) {
+        if (clock.NowNs() >= deadline_ns) {
+            return false;
+        }
+        clock.WaitUntilNs(lock, frame_cv_, deadline_ns);
+    }
+    return true;
+}
+
+int64_t IScreen::GetCaptureTimeMs() { return GetCurrentTimeMs(); }
+
+CaptureStats IScreen::GetCaptureStats() const {
+    std::lock_guard<std::mutex> lock(frame_mutex_);
+    return stats_;
+}
+
+void IScreen::CaptureLoop() {
+    while (capture_flag_.load(std::memory_order_acquire)) {
+        int64_t next_time_ms = GetCurrentTimeMs() + capture_interval_ms_;
+
+        int index;
+        try {
+            index = CaptureFrame();
+        } catch (const std::exception& e) {
+            spdlog::error("Capture error: {}", e.what());
+            SleepForMs(100);
+            continue;
+        }
+        {
+            std::lock_guard<std::mutex> lock(frame_mutex_);
+            if (latest_seq_ > read_seq_) {
+                ++stats_.dropped;
+            }
+            PublishFrame(index);
+        }
+        frame_cv_.notify_all();
+
+        int64_t wait_ms = next_time_ms - GetCurrentTimeMs();
+        if (wait_ms > 0) {
+            SleepForMs(wait_ms);
+        }
+    }
+}
+
+int IScreen::CaptureFrame() {
+    // only the capturing thread moves latest_index_ and readers never touch
+    // any other slot, so the next slot can be filled without frame_mutex_
+    int index = (latest_index_ + 1) % kFrameRingSize;
+    Frame& slot = frame_ring_[index];
+    if (slot.img.u != nullptr && slot.img.u->refcount > 1) {
+        // a consumer still holds this buffer, detach instead of overwriting it
+        slot.img.release();
+    }
+    {
+        std::lock_guard<std::mutex> lock(regions_mutex_);
+        if (regions_.empty()) {
+            CaptureTo(slot.img);
+        } else {
+            CaptureTo(slot.img, regions_);
+        }
+        slot.fingerprint = CalcFingerprint(slot.img, regions_);
+    }
+    slot.capture_time_ms = GetCaptureTimeMs();
+    return index;
+}
+
+const Frame& IScreen::PublishFrame(int index) {
+    latest_index_ = index;
+    ++latest_seq_;
+    ++stats_.captured;
+    return frame_ring_[index];
+}
+
+Frame IScreen::ReadFrame(const Frame& frame) {
+    Frame result = frame;
+    result.is_new = frame.fingerprint != read_fingerprint_;
+    read_fingerprint_ = frame.fingerprint;
+    if (result.is_new && recorder_) {
+        recorder_->Push(result);
     }
-    return frame_;
+    return result;
 }
 
-} // namespace psh
\ No newline at end of file
+} // namespace psh
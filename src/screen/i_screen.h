@@ -3,16 +3,26 @@
 #ifndef PSH_SCREEN_I_SCREEN_H_
 #define PSH_SCREEN_I_SCREEN_H_
 
+#include <array>
 #include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
 #include <mutex>
+#include <thread>
+#include <vector>
 
 #include <opencv2/opencv.hpp>
 
 namespace psh {
 
+class FrameRecorder;
+
 struct Frame {
     cv::Mat img;
     int64_t capture_time_ms;
+    uint64_t fingerprint = 0;
+    bool is_new = true; // differs from the previous frame from GetFrame
 
     Frame() : capture_time_ms(0) {}
     Frame(cv::Mat image, int64_t time_ms)
@@ -25,23 +35,84 @@ struct Frame {
     ~Frame() = default;
 };
 
+struct CaptureStats {
+    uint64_t captured = 0;
+    uint64_t dropped = 0;   // captured but replaced before being read
+    uint64_t stale = 0;     // read when older than the stale threshold
+    uint64_t duplicate = 0; // same frame read again
+};
+
 class IScreen {
 public:
-    virtual ~IScreen() = default;
+    virtual ~IScreen();
 
     Frame GetFrame();
     Frame GetFrame(int max_interval_ms);
 
+    // Opt-in producer thread, GetFrame then returns the newest captured frame
+    // without waiting for a capture. Implementations must call StopCapture
+    // in their destructor.
+    bool StartCapture(int interval_ms = 0, int stale_ms = 50);
+    void StopCapture();
+    bool IsCapturing() const {
+        return capture_flag_.load(std::memory_order_acquire);
+    }
+    CaptureStats GetCaptureStats() const;
+    // Blocks until the capture thread published a frame after the one the
+    // last GetFrame returned. False on timeout, returns at once when no
+    // capture thread runs.
+    bool WaitForNewFrame(int timeout_ms);
+
+    // Restricts following captures to the given regions of the display,
+    // pixels outside of them keep stale content, black in a frame buffer
+    // that was just allocated. Empty captures everything.
+    void SetCaptureRegions(std::vector<cv::Rect> regions);
+
+    // Every frame GetFrame returns with is_new set is pushed to the recorder.
+    void SetRecorder(std::shared_ptr<FrameRecorder> recorder);
+
     virtual cv::Mat Capture() = 0;
+    virtual void CaptureTo(cv::Mat& dst) { dst = Capture(); }
+    virtual void CaptureTo(cv::Mat& dst,
+                           const std::vector<cv::Rect>& /*regions*/) {
+        CaptureTo(dst);
+    }
     virtual int GetDisplayWidth() = 0;
     virtual int GetDisplayHeight() = 0;
 
+protected:
+    // time stamped on the frame filled by the last CaptureTo
+    virtual int64_t GetCaptureTimeMs();
+
 private:
-    Frame frame_;
+    static constexpr int kFrameRingSize = 3;
+
+    void CaptureLoop();
+    int CaptureFrame();
+    const Frame& PublishFrame(int index);
+    Frame ReadFrame(const Frame& frame);
+
+    std::array<Frame, kFrameRingSize> frame_ring_;
+    int latest_index_ = -1;
+    uint64_t latest_seq_ = 0;
+    uint64_t read_seq_ = 0;
+    uint64_t read_fingerprint_ = 0;
+    CaptureStats stats_;
+    int capture_interval_ms_ = 0;
+    int stale_ms_ = 0;
+
+    std::atomic_bool capture_flag_{false};
+    std::thread capture_thread_;
+    std::condition_variable frame_cv_;
 
     mutable std::mutex frame_mutex_;
+
+    std::vector<cv::Rect> regions_;
+    std::mutex regions_mutex_;
+
+    std::shared_ptr<FrameRecorder> recorder_;
 };
 
 } // namespace psh
 
-#endif // !PSH_SCREEN_I_SCREEN_H_
\ No newline at end of file
+#endif // !PSH_SCREEN_I_SCREEN_H_
@@ -0,0 +1,229 @@
+#include "screen/replay_screen.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#include <spdlog/spdlog.h>
+
+#include "common/time_utils.h"
+#include "screen/frame_recorder.h"
+
+namespace psh {
+
+ReplayScreen::ReplayScreen(const std::filesystem::path& path, Mode mode)
+    : mode_(mode) {
+    if (std::filesystem::is_directory(path)) {
+        opened_ = OpenDirectory(path);
+    } else if (path.extension() == kRecordingExtension) {
+        opened_ = OpenRecording(path);
+    } else {
+        opened_ = OpenVideo(path);
+    }
+    if (!opened_) {
+        spdlog::error("Failed to open replay: {}", path.string());
+        finished_.store(true, std::memory_order_release);
+    }
+}
+
+ReplayScreen::~ReplayScreen() { StopCapture(); }
+
+void ReplayScreen::Rewind() {
+    cursor_ = 0;
+    start_time_ms_ = -1;
+    frame_buffer_.release();
+    if (video_.isOpened()) {
+        video_.set(cv::CAP_PROP_POS_FRAMES, 0);
+        next_time_ms_ = GrabNextVideoFrame();
+    }
+    finished_.store(!opened_, std::memory_order_release);
+}
+
+cv::Mat ReplayScreen::Capture() {
+    cv::Mat dst;
+    CaptureTo(dst);
+    return dst;
+}
+
+void ReplayScreen::CaptureTo(cv::Mat& dst) {
+    if (!opened_) {
+        throw std::runtime_error("Replay is not opened");
+    }
+    if (video_.isOpened()) {
+        CaptureFromVideo();
+    } else {
+        CaptureFromIndex();
+    }
+    // loaded frames are never written in place, sharing them is safe
+    dst = frame_buffer_;
+}
+
+bool ReplayScreen::OpenDirectory(const std::filesystem::path& dir) {
+    std::ifstream index_file(dir / kIndexFileName);
+    if (!index_file.is_open()) {
+        return false;
+    }
+    std::string line;
+    while (std::getline(index_file, line)) {
+        std::istringstream iss(line);
+        IndexEntry entry;
+        std::string file;
+        if (iss >> entry.capture_time_ms >> file) {
+            entry.file = dir / file;
+            entries_.push_back(std::move(entry));
+        }
+    }
+    if (entries_.empty()) {
+        return false;
+    }
+    std::stable_sort(entries_.begin(), entries_.end(),
+                     [](const IndexEntry& lhs, const IndexEntry& rhs) {
+                         return lhs.capture_time_ms < rhs.capture_time_ms;
+                     });
+
+    cv::Mat first = cv::imread(entries_.front().file.string());
+    if (first.empty()) {
+        return false;
+    }
+    display_width_ = first.cols;
+    display_height_ = first.rows;
+    spdlog::info("Replay opened: {}, {} frames", dir.string(),
+                 entries_.size());
+    return true;
+}
+
+bool ReplayScreen::OpenRecording(const std::filesystem::path& file) {
+    if (!recording_.Open(file) ||
+        recording_.Size() < sizeof(RecordingHeader)) {
+        return false;
+    }
+    const auto& header =
+        *reinterpret_cast<const RecordingHeader*>(recording_.Data());
+    if (std::memcmp(header.magic, kRecordingMagic, sizeof(header.magic)) !=
+            0 ||
+        header.version != kRecordingVersion || header.count == 0 ||
+        header.count > header.capacity ||
+        recording_.Size() <
+            FrameRecorder::GetFrameOffset(header, header.count)) {
+        recording_.Close();
+        return false;
+    }
+    const auto* index = reinterpret_cast<const int64_t*>(
+        recording_.Data() + sizeof(RecordingHeader));
+    for (uint32_t i = 0; i < header.count; ++i) {
+        entries_.push_back(IndexEntry{index[i], {}});
+    }
+    display_width_ = header.display_width;
+    display_height_ = header.display_height;
+    covers_display_ = header.roi_x == 0 && header.roi_y == 0 &&
+                      header.roi_width == header.display_width &&
+                      header.roi_height == header.display_height;
+    spdlog::info("Replay opened: {}, {} frames", file.string(),
+                 entries_.size());
+    return true;
+}
+
+bool ReplayScreen::OpenVideo(const std::filesystem::path& file) {
+    if (!video_.open(file.string()) ||
+        (next_time_ms_ = GrabNextVideoFrame()) == kEndOfVideo) {
+        video_.release();
+        return false;
+    }
+    display_width_ =
+        static_cast<int>(video_.get(cv::CAP_PROP_FRAME_WIDTH));
+    display_height_ =
+        static_cast<int>(video_.get(cv::CAP_PROP_FRAME_HEIGHT));
+    spdlog::info("Replay opened: {}", file.string());
+    return true;
+}
+
+cv::Mat ReplayScreen::LoadEntry(size_t index) {
+    if (!recording_.IsOpened()) {
+        cv::Mat img = cv::imread(entries_[index].file.string());
+        if (img.empty()) {
+            throw std::runtime_error("Failed to read replay frame: " +
+                                     entries_[index].file.string());
+        }
+        return img;
+    }
+    const auto& header =
+        *reinterpret_cast<const RecordingHeader*>(recording_.Data());
+    cv::Rect roi(header.roi_x, header.roi_y, header.roi_width,
+                 header.roi_height);
+    // pixels outside of the recorded roi stay black
+    cv::Mat img = cv::Mat::zeros(display_height_, display_width_, CV_8UC3);
+    size_t offset = FrameRecorder::GetFrameOffset(header, index);
+    cv::Mat src(roi.height, roi.width, CV_8UC3, recording_.Data() + offset);
+    src.copyTo(img(roi));
+    return img;
+}
+
+void ReplayScreen::CaptureFromIndex() {
+    size_t prev_cursor = cursor_;
+    if (mode_ == Mode::kFastest) {
+        cursor_ = std::min(cursor_ + 1, entries_.size());
+    } else {
+        int64_t elapsed_ms = GetElapsedMs();
+        int64_t first_ms = entries_.front().capture_time_ms;
+        // always serve at least the first frame
+        cursor_ = std::max<size_t>(cursor_, 1);
+        while (cursor_ < entries_.size() &&
+               entries_[cursor_].capture_time_ms - first_ms <= elapsed_ms) {
+            ++cursor_;
+        }
+    }
+
+    const IndexEntry& entry = entries_[cursor_ - 1];
+    if (cursor_ != prev_cursor) {
+        frame_buffer_ = LoadEntry(cursor_ - 1);
+    }
+    capture_time_ms_ = GetStartTimeMs() + entry.capture_time_ms -
+                       entries_.front().capture_time_ms;
+    if (cursor_ == entries_.size()) {
+        finished_.store(true, std::memory_order_release);
+    }
+}
+
+void ReplayScreen::CaptureFromVideo() {
+    int64_t elapsed_ms = GetElapsedMs();
+    // real-time mode skips to the newest due frame, fastest mode steps one
+    // frame per capture
+    while (next_time_ms_ != kEndOfVideo) {
+        if (!frame_buffer_.empty() && mode_ == Mode::kRealTime &&
+            next_time_ms_ > elapsed_ms) {
+            break;
+        }
+        cv::Mat img;
+        video_.retrieve(img);
+        frame_buffer_ = img;
+        capture_time_ms_ = GetStartTimeMs() + next_time_ms_;
+        next_time_ms_ = GrabNextVideoFrame();
+        if (mode_ == Mode::kFastest) {
+            break;
+        }
+    }
+    if (next_time_ms_ == kEndOfVideo) {
+        finished_.store(true, std::memory_order_release);
+    }
+}
+
+int64_t ReplayScreen::GrabNextVideoFrame() {
+    if (!video_.grab()) {
+        return kEndOfVideo;
+    }
+    return static_cast<int64_t>(video_.get(cv::CAP_PROP_POS_MSEC));
+}
+
+int64_t ReplayScreen::GetElapsedMs() {
+    return GetCurrentTimeMs() - GetStartTimeMs();
+}
+
+int64_t ReplayScreen::GetStartTimeMs() {
+    if (start_time_ms_ < 0) {
+        start_time_ms_ = GetCurrentTimeMs();
+    }
+    return start_time_ms_;
+}
+
+} // namespace psh
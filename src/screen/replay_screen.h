@@ -0,0 +1,92 @@
+#pragma once
+
+#ifndef PSH_SCREEN_REPLAY_SCREEN_H_
+#define PSH_SCREEN_REPLAY_SCREEN_H_
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include "common/mapped_file.h"
+#include "screen/i_screen.h"
+
+namespace psh {
+
+// Plays back a recorded session, either a directory with an index file of
+// "<capture_time_ms> <image file>" lines, a FrameRecorder recording or a
+// video file.
+class ReplayScreen : public IScreen {
+public:
+    enum class Mode {
+        kRealTime, // frames follow their recorded timing
+        kFastest,  // every capture returns the next frame
+    };
+
+    inline static const std::string kIndexFileName = "index.txt";
+    inline static const std::string kRecordingExtension = ".pshrec";
+
+    ReplayScreen(const std::filesystem::path& path,
+                 Mode mode = Mode::kRealTime);
+    virtual ~ReplayScreen();
+
+    bool IsOpened() const { return opened_; }
+    // false for recordings of a display region, pixels outside of it are
+    // black
+    bool CoversDisplay() const { return covers_display_; }
+    bool IsFinished() const {
+        return finished_.load(std::memory_order_acquire);
+    }
+    void Rewind();
+
+    using IScreen::CaptureTo;
+    cv::Mat Capture() override;
+    void CaptureTo(cv::Mat& dst) override;
+    int GetDisplayWidth() override { return display_width_; }
+    int GetDisplayHeight() override { return display_height_; }
+
+protected:
+    int64_t GetCaptureTimeMs() override { return capture_time_ms_; }
+
+private:
+    struct IndexEntry {
+        int64_t capture_time_ms;
+        std::filesystem::path file;
+    };
+
+    static constexpr int64_t kEndOfVideo = INT64_MAX;
+
+    bool OpenDirectory(const std::filesystem::path& dir);
+    bool OpenRecording(const std::filesystem::path& file);
+    bool OpenVideo(const std::filesystem::path& file);
+    cv::Mat LoadEntry(size_t index);
+    void CaptureFromIndex();
+    void CaptureFromVideo();
+    int64_t GrabNextVideoFrame();
+    int64_t GetElapsedMs();
+    int64_t GetStartTimeMs();
+
+    Mode mode_;
+    bool opened_ = false;
+    bool covers_display_ = true;
+    std::atomic_bool finished_{false};
+    int display_width_ = -1;
+    int display_height_ = -1;
+
+    std::vector<IndexEntry> entries_;
+    MappedFile recording_;
+    size_t cursor_ = 0;
+    cv::VideoCapture video_;
+    int64_t next_time_ms_ = kEndOfVideo;
+
+    cv::Mat frame_buffer_;
+    int64_t start_time_ms_ = -1;
+    int64_t capture_time_ms_ = 0;
+};
+
+} // namespace psh
+
+#endif // !PSH_SCREEN_REPLAY_SCREEN_H_
@@ -1,92 +1,95 @@
 #include "score_touch.h"
 
-#include <functional>
+#include <algorithm>
+#include <cmath>
 #include <unordered_set>
+#include <utility>
 
 namespace MMW = MikuMikuWorld;
 
 namespace {
 using namespace psh;
 
-float lerp(float start, float end, float percentage) {
-    return start + percentage * (end - start);
-}
-
-float easeIn(float start, float end, float ratio) {
-    return lerp(start, end, ratio * ratio);
-}
-
-float easeOut(float start, float end, float ratio) {
-    return lerp(start, end, 1 - (1 - ratio) * (1 - ratio));
-}
-
-std::function<float(float, float, float)> getEaseFunction(MMW::EaseType ease) {
+// slopes of the cubic spline matching the ease, t^2 for ease in and
+// 1 - (1 - t)^2 for ease out
+std::pair<float, float> GetEaseSlopes(MMW::EaseType ease) {
     switch (ease) {
-        case MMW::EaseType::EaseIn: return easeIn;
-        case MMW::EaseType::EaseOut: return easeOut;
+        case MMW::EaseType::EaseIn: return {0.0f, 2.0f};
+        case MMW::EaseType::EaseOut: return {2.0f, 0.0f};
         default: break;
     }
-    return lerp;
-}
-
-float TicksToMs(int ticks, int beat_ticks, float bpm) {
-    return static_cast<int64_t>(ticks) * 60 * 1000 / bpm / beat_ticks;
-}
-
-int AccumulateTicks(int tick, int beat_ticks, std::vector<MMW::Tempo> bpms) {
-    float total = 0;
-    int acc_ticks = 0;
-    int last_bpm = 0;
-    for (int i = 0; i < bpms.size() - 1; ++i) {
-        last_bpm = i;
-        int ticks = bpms[i + 1].tick - bpms[i].tick;
-        if (acc_ticks + ticks >= tick) break;
-
-        acc_ticks += ticks;
-        total +=
-            TicksToMs(bpms[i + 1].tick - bpms[i].tick, beat_ticks, bpms[i].bpm);
-        last_bpm = i + 1;
-    }
-    total +=
-        TicksToMs(tick - bpms[last_bpm].tick, beat_ticks, bpms[last_bpm].bpm);
-    return static_cast<int>(total);
+    return {1.0f, 1.0f};
 }
 
-NoteTouch NoteToTouch(const MMW::Note &note, const MMW::Score &score) {
+NoteTouch NoteToTouch(const MMW::Note &note, const TempoTimeline &timeline) {
     NoteTouch ret;
-    ret.delay_ms = AccumulateTicks(note.tick, 480, score.tempoChanges);
+    ret.delay_ms = timeline.TickToMs(note.tick);
     ret.lane = note.lane + note.width / 2.0;
     ret.friction = note.friction;
     ret.flick = note.flick;
     return ret;
 }
 
-void InterpolateHoldStep(std::vector<HoldStepTouch> &hold_steps, int begin_ms,
-                         int begin_lane, int end_ms, int end_lane,
-                         MMW::EaseType ease_type) {
-    auto ease_func = getEaseFunction(ease_type);
-    int duration = end_ms - begin_ms;
-    for (int i = 0; i <= duration; i += 10) {
-        if (hold_steps.empty() ||
-            hold_steps.back().delay_ms < begin_ms + i - 10) {
-            hold_steps.push_back(HoldStepTouch{
-                begin_ms + i,
-                ease_func(begin_lane, end_lane, i / (float)duration)});
-        }
+void AddHoldSegment(std::vector<HoldSegmentTouch> &segments, int begin_ms,
+                    float begin_lane, int end_ms, float end_lane,
+                    MMW::EaseType ease_type) {
+    if (end_ms <= begin_ms) {
+        return;
     }
+    auto [slope_in, slope_out] = GetEaseSlopes(ease_type);
+    segments.push_back(HoldSegmentTouch{begin_ms, begin_lane, end_ms, end_lane,
+                                        slope_in, slope_out});
 }
 
 } // namespace
 
 namespace psh {
 
+TempoTimeline::TempoTimeline(const std::vector<MMW::Tempo> &tempos,
+                             int beat_ticks) {
+    constexpr double kDefaultBpm = 120.0;
+    constexpr double kUsPerMinute = 60'000'000.0;
+    segments_.reserve(std::max<size_t>(tempos.size(), 1));
+    for (const auto &tempo : tempos) {
+        segments_.push_back(
+            Segment{tempo.tick, kUsPerMinute / tempo.bpm / beat_ticks, 0});
+    }
+    if (segments_.empty()) {
+        segments_.push_back(
+            Segment{0, kUsPerMinute / kDefaultBpm / beat_ticks, 0});
+    }
+    std::stable_sort(segments_.begin(), segments_.end(),
+                     [](const Segment &lhs, const Segment &rhs) {
+                         return lhs.tick < rhs.tick;
+                     });
+    for (size_t i = 1; i < segments_.size(); ++i) {
+        const Segment &prev = segments_[i - 1];
+        segments_[i].begin_us =
+            prev.begin_us +
+            std::llround((segments_[i].tick - prev.tick) * prev.us_per_tick);
+    }
+}
+
+int64_t TempoTimeline::TickToUs(int tick) const {
+    // last tempo change at or before tick, ticks before the first change
+    // use the first tempo
+    auto it = std::upper_bound(
+        segments_.begin(), segments_.end(), tick,
+        [](int tick, const Segment &segment) { return tick < segment.tick; });
+    const Segment &segment =
+        it == segments_.begin() ? segments_.front() : *(it - 1);
+    return segment.begin_us +
+           std::llround((tick - segment.tick) * segment.us_per_tick);
+}
+
 ScoreTouch ScoreToTouch(const MMW::Score &score) {
+    TempoTimeline timeline(score.tempoChanges);
     ScoreTouch ret;
     std::unordered_set<int> hold_note_ids;
     for (const auto &[id, hold] : score.holdNotes) {
         HoldTouch ht;
-        ht.start = NoteToTouch(score.notes.at(hold.start.ID), score);
-        ht.end = NoteToTouch(score.notes.at(hold.end), score);
+        ht.start = NoteToTouch(score.notes.at(hold.start.ID), timeline);
+        ht.end = NoteToTouch(score.notes.at(hold.end), timeline);
         hold_note_ids.insert(hold.start.ID);
         hold_note_ids.insert(hold.end);
         int prev_ms = ht.start.delay_ms;
@@ -95,24 +98,24 @@ ScoreTouch ScoreToTouch(const MMW::Score &score) {
         for (const auto &step : hold.steps) {
             hold_note_ids.insert(step.ID);
             const auto &note = score.notes.at(step.ID);
-            int curr_ms = AccumulateTicks(note.tick, 480, score.tempoChanges);
+            int curr_ms = timeline.TickToMs(note.tick);
             float curr_lane = note.lane + note.width / 2.0;
             if (step.type != MMW::HoldStepType::Skip) {
-                InterpolateHoldStep(ht.steps, prev_ms, prev_lane, curr_ms,
-                                    curr_lane, prev_ease);
+                AddHoldSegment(ht.segments, prev_ms, prev_lane, curr_ms,
+                               curr_lane, prev_ease);
                 prev_ms = curr_ms;
                 prev_lane = curr_lane;
                 prev_ease = step.ease;
             }
         }
-        InterpolateHoldStep(ht.steps, prev_ms, prev_lane, ht.end.delay_ms,
-                            ht.end.lane, prev_ease);
+        AddHoldSegment(ht.segments, prev_ms, prev_lane, ht.end.delay_ms,
+                       ht.end.lane, prev_ease);
         ret.holds.push_back(ht);
     }
 
     for (const auto &[id, note] : score.notes) {
         if (hold_note_ids.find(id) == hold_note_ids.end()) {
-            ret.notes.push_back(NoteToTouch(note, score));
+            ret.notes.push_back(NoteToTouch(note, timeline));
         }
     }
     return ret;
@@ -1,3 +1,9 @@
+#pragma once
+
+#ifndef PSH_SUS_SCORE_TOUCH_H_
+#define PSH_SUS_SCORE_TOUCH_H_
+
+#include <cstdint>
 #include <vector>
 
 #include <MikuMikuWorld/NoteTypes.h>
@@ -5,6 +11,28 @@
 
 namespace psh {
 
+// Converts chart ticks to time. Built once per score, the time of every
+// tempo change is summed up front and a lookup is a binary search.
+class TempoTimeline {
+public:
+    explicit TempoTimeline(const std::vector<MikuMikuWorld::Tempo>& tempos,
+                           int beat_ticks = 480);
+
+    int64_t TickToUs(int tick) const;
+    int TickToMs(int tick) const {
+        return static_cast<int>(TickToUs(tick) / 1000);
+    }
+
+private:
+    struct Segment {
+        int tick;
+        double us_per_tick;
+        int64_t begin_us;
+    };
+
+    std::vector<Segment> segments_; // sorted by tick, never empty
+};
+
 struct NoteTouch {
     int delay_ms;
     float lane;
@@ -12,15 +40,21 @@ struct NoteTouch {
     MikuMikuWorld::FlickType flick;
 };
 
-struct HoldStepTouch {
-    int delay_ms;
-    float lane;
+// Glide between two hold steps, the ease is a cubic spline with the given
+// slopes at both ends.
+struct HoldSegmentTouch {
+    int begin_ms;
+    float begin_lane;
+    int end_ms;
+    float end_lane;
+    float slope_in;
+    float slope_out;
 };
 
 struct HoldTouch {
     NoteTouch start;
     NoteTouch end;
-    std::vector<HoldStepTouch> steps;
+    std::vector<HoldSegmentTouch> segments;
 };
 
 struct ScoreTouch {
@@ -28,6 +62,10 @@ struct ScoreTouch {
     std::vector<HoldTouch> holds;
 };
 
+// Cached touch plans are built from this, any change to its timing must
+// bump kTouchPlanVersion in player/touch_plan.h.
 ScoreTouch ScoreToTouch(const MikuMikuWorld::Score& score);
 
-} // namespace psh
\ No newline at end of file
+} // namespace psh
+
+#endif // !PSH_SUS_SCORE_TOUCH_H_
\ No newline at end of file
@@ -20,11 +20,11 @@
 #include <QEventLoop>
 #include <QDateTime>
 #include <QTimer>
-#include <MikuMikuWorld/SusParser.h>
 
 #include "common/command.h"
 #include "common/finalizer.hpp"
 #include "ocr/ocr_utils.h"
+#include "sus/sus_parser.h"
 
 namespace psh {
 
@@ -32,34 +32,34 @@ SusLoader::SusLoader() : QObject(nullptr) {}
 
 void SusLoader::LoadSusByName(const QString& song_name,
                               const QString& difficulty, bool force_download,
-                              bool exact_match) {
+                              bool exact_match, PrepareFunc prepare) {
     auto& inst = Instance();
     if (inst.is_loading_.exchange(true)) {
         spdlog::warn("SusLoader: load already in progress, ignoring request");
         return;
     }
     emit inst.LoadStarted();
-    std::thread load_thread(
-        [&inst, song_name, difficulty, force_download, exact_match]() {
-            Finalizer guard([&inst]() { inst.is_loading_.store(false); });
-            {
-                std::lock_guard<std::mutex> lk(inst.sus_mutex_);
-                inst.sus_.reset();
-            }
-            auto sus = inst.LoadSusImpl(song_name, difficulty, force_download,
-                                        exact_match);
-            {
-                std::lock_guard<std::mutex> lk(inst.sus_mutex_);
-                inst.sus_ = sus;
-            }
-            emit inst.LoadFinished();
-        });
+    std::thread load_thread([&inst, song_name, difficulty, force_download,
+                             exact_match, prepare = std::move(prepare)]() {
+        Finalizer guard([&inst]() { inst.is_loading_.store(false); });
+        {
+            std::lock_guard<std::mutex> lk(inst.sus_mutex_);
+            inst.sus_.reset();
+        }
+        auto sus = inst.LoadSusImpl(song_name, difficulty, force_download,
+                                    exact_match, prepare);
+        {
+            std::lock_guard<std::mutex> lk(inst.sus_mutex_);
+            inst.sus_ = sus;
+        }
+        emit inst.LoadFinished();
+    });
     load_thread.detach();
 }
 
 void SusLoader::LoadSusByImg(const cv::Mat& song_name_img,
                              const QString& difficulty, bool force_download,
-                             bool exact_match) {
+                             bool exact_match, PrepareFunc prepare) {
     auto& inst = Instance();
     if (inst.is_loading_.exchange(true)) {
         spdlog::warn("SusLoader: load already in progress, ignoring request");
@@ -67,7 +67,7 @@ void SusLoader::LoadSusByImg(const cv::Mat& song_name_img,
     }
     emit inst.LoadStarted();
     std::thread load_thread([&inst, song_name_img, difficulty, force_download,
-                             exact_match]() {
+                             exact_match, prepare = std::move(prepare)]() {
         Finalizer guard([&inst]() { inst.is_loading_.store(false); });
         {
             std::lock_guard<std::mutex> lk(inst.sus_mutex_);
@@ -79,7 +79,7 @@ void SusLoader::LoadSusByImg(const cv::Mat& song_name_img,
             return;
         }
         auto sus = inst.LoadSusImpl(song_name, difficulty, force_download,
-                                    exact_match);
+                                    exact_match, prepare);
         {
             std::lock_guard<std::mutex> lk(inst.sus_mutex_);
             inst.sus_ = sus;
@@ -396,7 +396,7 @@ std::vector<std::pair<SusLoader::SongInfo, double>> SusLoader::SearchSongByName(
 
 std::shared_ptr<SusLoader::SusResult> SusLoader::LoadSusImpl(
     const QString& song_name, const QString& difficulty, bool force_download,
-    bool exact_match) {
+    bool exact_match, const PrepareFunc& prepare) {
     // 搜索歌曲
     auto matches = SearchSongByName(song_name, exact_match);
     if (!exact_match) {
@@ -432,8 +432,8 @@ std::shared_ptr<SusLoader::SusResult> SusLoader::LoadSusImpl(
         const QString existing =
             CheckChartFileExists(selected.title, difficulty);
         if (!existing.isEmpty()) {
-            MikuMikuWorld::SusParser parser;
-            auto sus = parser.parse(existing.toStdString());
+            auto sus =
+                ParseSus(std::filesystem::path(existing.toStdWString()));
             spdlog::info("SusLoader: loaded cached sus: {}, diff: {}",
                          selected.title.toUtf8().constData(),
                          difficulty.toUtf8().constData());
@@ -441,7 +441,8 @@ std::shared_ptr<SusLoader::SusResult> SusLoader::LoadSusImpl(
             result->sus = std::move(sus);
             result->title = selected.title;
             result->difficulty = difficulty;
-            emit SusUpdated(result);
+            result->path = existing;
+            PublishSus(result, prepare);
             return result;
         }
     }
@@ -463,18 +464,30 @@ std::shared_ptr<SusLoader::SusResult> SusLoader::LoadSusImpl(
     }
 
     // 解析
-    MikuMikuWorld::SusParser parser;
-    auto sus = parser.parse(path.toStdString());
+    auto sus = ParseSus(std::filesystem::path(path.toStdWString()));
     spdlog::info("SusLoader: successfully loaded sus file: {}",
                  path.toUtf8().constData());
     auto result = std::make_shared<SusResult>();
     result->sus = std::move(sus);
     result->title = selected.title;
     result->difficulty = difficulty;
-    emit SusUpdated(result);
+    result->path = path;
+    PublishSus(result, prepare);
     return result;
 }
 
+void SusLoader::PublishSus(const std::shared_ptr<SusResult>& result,
+                           const PrepareFunc& prepare) {
+    if (prepare) {
+        try {
+            result->prepared = prepare(*result);
+        } catch (const std::exception& e) {
+            spdlog::error("SusLoader: failed to prepare chart: {}", e.what());
+        }
+    }
+    emit SusUpdated(result);
+}
+
 QString SusLoader::MakeSafeFileName(const QString& base) const {
     static const QRegularExpression invalid(
         QStringLiteral("[\\\\/:*?\"<>|\\x00-\\x1F]"));
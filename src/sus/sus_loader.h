@@ -19,6 +19,8 @@
 
 namespace psh {
 
+struct PreparedChart;
+
 class SusLoader : public QObject {
 public:
     Q_OBJECT
@@ -34,20 +36,29 @@ public:
         MikuMikuWorld::SUS sus;
         QString title;
         QString difficulty;
+        QString path; // of the .sus file
+        // built on the load thread by the prepare function of the load
+        std::shared_ptr<PreparedChart> prepared;
     };
 
+    using PrepareFunc =
+        std::function<std::shared_ptr<PreparedChart>(const SusResult&)>;
+
     ~SusLoader() = default;
 
     static SusLoader& Instance();
 
+    // prepare runs on the load thread before SusUpdated is emitted
     static void LoadSusByName(const QString& song_name,
                               const QString& difficulty,
                               bool force_download = false,
-                              bool exact_match = false);
+                              bool exact_match = false,
+                              PrepareFunc prepare = {});
     static void LoadSusByImg(const cv::Mat& song_name_img,
                              const QString& difficulty,
                              bool force_download = false,
-                             bool exact_match = false);
+                             bool exact_match = false,
+                             PrepareFunc prepare = {});
     static std::shared_ptr<SusResult> GetSus();
 
     static void RefreshSongsCache();
@@ -91,10 +102,11 @@ private:
                                bool substring_match) const;
     std::vector<std::pair<SongInfo, double>> SearchSongByName(
         const QString& song_name, bool exact_match = false);
-    std::shared_ptr<SusLoader::SusResult> LoadSusImpl(const QString& song_name,
-                                                      const QString& difficulty,
-                                                      bool force_download,
-                                                      bool exact_match);
+    std::shared_ptr<SusLoader::SusResult> LoadSusImpl(
+        const QString& song_name, const QString& difficulty,
+        bool force_download, bool exact_match, const PrepareFunc& prepare);
+    void PublishSus(const std::shared_ptr<SusResult>& result,
+                    const PrepareFunc& prepare);
 
     QString MakeSafeFileName(const QString& base) const;
     QByteArray FetchUrlWithRetry(const QUrl& url) const;
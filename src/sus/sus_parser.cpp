@@ -0,0 +1,416 @@
+#include "sus/sus_parser.h"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+#include "common/mapped_file.h"
+
+namespace MMW = MikuMikuWorld;
+
+namespace {
+
+constexpr std::array<int8_t, 256> MakeBase36Table() {
+    std::array<int8_t, 256> table{};
+    for (size_t i = 0; i < table.size(); ++i) {
+        table[i] = -1;
+    }
+    for (int i = 0; i < 10; ++i) {
+        table['0' + i] = static_cast<int8_t>(i);
+    }
+    for (int i = 0; i < 26; ++i) {
+        table['a' + i] = static_cast<int8_t>(10 + i);
+        table['A' + i] = static_cast<int8_t>(10 + i);
+    }
+    return table;
+}
+
+constexpr std::array<int8_t, 256> kBase36 = MakeBase36Table();
+
+// single digit, the index may be past the end for odd length data
+int GetBase36Digit(std::string_view text, size_t index) {
+    int value =
+        index < text.size() ? kBase36[static_cast<uint8_t>(text[index])] : -1;
+    if (value < 0) {
+        throw std::runtime_error("Invalid sus digit in: " + std::string(text));
+    }
+    return value;
+}
+
+bool StartsWith(std::string_view text, std::string_view key) {
+    return text.size() >= key.size() && text.substr(0, key.size()) == key;
+}
+
+bool EndsWith(std::string_view text, std::string_view key) {
+    return text.size() >= key.size() &&
+           text.substr(text.size() - key.size()) == key;
+}
+
+// same as IO::isDigit, a leading minus is allowed
+bool IsDigits(std::string_view text) {
+    if (text.empty()) {
+        return false;
+    }
+    return std::all_of(text.begin() + (text[0] == '-' ? 1 : 0), text.end(),
+                       [](char c) { return std::isdigit(uint8_t(c)) != 0; });
+}
+
+std::string_view Trim(std::string_view text) {
+    size_t begin = text.find_first_not_of(' ');
+    if (begin == std::string_view::npos) {
+        return {};
+    }
+    size_t end = text.find_last_not_of(' ');
+    return text.substr(begin, end - begin + 1);
+}
+
+// same as IO::split, empty text gives no values
+std::vector<std::string_view> Split(std::string_view text, char delim) {
+    std::vector<std::string_view> values;
+    size_t begin = 0;
+    size_t end = text.size() - 1;
+    while (begin < text.size() && end != std::string_view::npos) {
+        end = text.find(delim, begin);
+        values.push_back(text.substr(begin, end - begin));
+        begin = end + 1;
+    }
+    return values;
+}
+
+// command values are rare, copying them for the C conversions keeps their
+// exact behavior
+int ToInt(std::string_view text) { return atoi(std::string(text).c_str()); }
+double ToDouble(std::string_view text) {
+    return atof(std::string(text).c_str());
+}
+
+struct DataLine {
+    std::string_view header;
+    std::string_view data;
+    int measure; // measure offset applied
+};
+
+class SusTextParser {
+public:
+    MMW::SUS Parse(std::string_view text);
+
+private:
+    static bool IsCommand(std::string_view line);
+    static void AppendNoteStreams(std::vector<MMW::SUSNote>& stream,
+                                  MMW::SUSNoteStream& streams);
+
+    void ProcessCommand(std::string_view line);
+    DataLine ReadDataLine(std::string_view line) const;
+    void BuildBars(const std::vector<MMW::BarLength>& bar_lengths);
+    int GetTicks(int measure, int i, int total) const;
+    void AppendNotes(const DataLine& line,
+                     std::vector<MMW::SUSNote>& notes) const;
+    std::vector<MMW::BPM> GetBpms(const std::vector<DataLine>& lines) const;
+    std::vector<MMW::HiSpeed> GetHiSpeeds(
+        const std::vector<DataLine>& lines) const;
+
+    int ticks_per_beat_ = 480;
+    int measure_offset_ = 0;
+    float wave_offset_ = 0;
+    std::string title_;
+    std::string artist_;
+    std::string designer_;
+    std::map<std::string, float, std::less<>> bpm_definitions_;
+    std::vector<MMW::Bar> bars_;
+    std::vector<int> bar_end_ticks_; // ticks of all bars up to the index
+};
+
+bool SusTextParser::IsCommand(std::string_view line) {
+    if (line.size() > 1 && std::isdigit(uint8_t(line[1]))) {
+        return false;
+    }
+    // text value commands
+    size_t first_quote = line.find('"');
+    if (first_quote != std::string_view::npos) {
+        size_t name_end = line.find(' ');
+        if (name_end == std::string_view::npos ||
+            line.substr(0, name_end).find(':') != std::string_view::npos) {
+            return false;
+        }
+        return first_quote != line.rfind('"');
+    }
+    return line.find(':') == std::string_view::npos;
+}
+
+void SusTextParser::ProcessCommand(std::string_view line) {
+    size_t key_pos = line.find(' ');
+    if (key_pos == std::string_view::npos) {
+        return;
+    }
+    std::string key(line.substr(1, key_pos - 1));
+    std::string_view value = line.substr(key_pos + 1);
+    std::transform(key.begin(), key.end(), key.begin(),
+                   [](char c) { return char(std::toupper(uint8_t(c))); });
+    if (StartsWith(value, "\"") && EndsWith(value, "\"")) {
+        value = value.substr(1, value.size() - 2);
+    }
+
+    if (key == "TITLE") {
+        title_ = value;
+    } else if (key == "ARTIST") {
+        artist_ = value;
+    } else if (key == "DESIGNER") {
+        designer_ = value;
+    } else if (key == "WAVEOFFSET") {
+        wave_offset_ = ToDouble(value);
+    } else if (key == "MEASUREBS") {
+        measure_offset_ = ToInt(value);
+    } else if (key == "REQUEST") {
+        auto args = Split(value, ' ');
+        if (args.size() == 2 && args[0] == "ticks_per_beat") {
+            ticks_per_beat_ = ToInt(args[1]);
+        }
+    }
+}
+
+DataLine SusTextParser::ReadDataLine(std::string_view line) const {
+    // without a separator the header runs to the end and the data is the
+    // whole line, as in MikuMikuWorld::SusDataLine
+    size_t separator = line.find(':');
+    DataLine ret{Trim(line.substr(1, separator - 1)),
+                 Trim(line.substr(separator + 1)), measure_offset_};
+    std::string_view measure = ret.header.substr(0, 3);
+    if (IsDigits(measure)) {
+        ret.measure += ToInt(measure);
+    }
+    return ret;
+}
+
+void SusTextParser::BuildBars(const std::vector<MMW::BarLength>& bar_lengths) {
+    // the float to int conversions follow MikuMikuWorld::SusParser::getBars
+    bars_.clear();
+    bars_.reserve(bar_lengths.size());
+    bars_.push_back(
+        MMW::Bar{bar_lengths[0].bar,
+                 static_cast<int>(bar_lengths[0].length * ticks_per_beat_), 0});
+    for (size_t i = 1; i < bar_lengths.size(); ++i) {
+        int measure = bar_lengths[i].bar;
+        int ticks_per_measure = bar_lengths[i].length * ticks_per_beat_;
+        int ticks = (measure - bar_lengths[i - 1].bar) *
+                    bar_lengths[i - 1].length * ticks_per_beat_;
+        bars_.push_back(MMW::Bar{measure, ticks_per_measure, ticks});
+    }
+    std::sort(bars_.begin(), bars_.end(),
+              [](const MMW::Bar& lhs, const MMW::Bar& rhs) {
+                  return lhs.measure < rhs.measure;
+              });
+
+    bar_end_ticks_.resize(bars_.size());
+    int ticks = 0;
+    for (size_t i = 0; i < bars_.size(); ++i) {
+        ticks += bars_[i].ticks;
+        bar_end_ticks_[i] = ticks;
+    }
+}
+
+int SusTextParser::GetTicks(int measure, int i, int total) const {
+    // last bar starting at or before measure, measures before the first bar
+    // are counted from the first one
+    auto it = std::upper_bound(
+        bars_.begin(), bars_.end(), measure,
+        [](int measure, const MMW::Bar& bar) { return measure < bar.measure; });
+    size_t index = it == bars_.begin() ? 0 : it - bars_.begin() - 1;
+    int bar_ticks = it == bars_.begin() ? 0 : bar_end_ticks_[index];
+    const MMW::Bar& bar = bars_[index];
+    return bar_ticks + (measure - bar.measure) * bar.ticksPerMeasure +
+           (i * bar.ticksPerMeasure) / total;
+}
+
+void SusTextParser::AppendNotes(const DataLine& line,
+                                std::vector<MMW::SUSNote>& notes) const {
+    std::string_view data = line.data;
+    int total = static_cast<int>(data.size());
+    for (size_t i = 0; i < data.size(); i += 2) {
+        if (data[i] == '0' && i + 1 < data.size() && data[i + 1] == '0') {
+            continue;
+        }
+        notes.push_back(MMW::SUSNote{
+            GetTicks(line.measure, static_cast<int>(i), total),
+            GetBase36Digit(line.header, 4), GetBase36Digit(data, i + 1),
+            GetBase36Digit(data, i)});
+    }
+}
+
+std::vector<MMW::BPM> SusTextParser::GetBpms(
+    const std::vector<DataLine>& lines) const {
+    std::vector<MMW::BPM> bpms;
+    for (const auto& line : lines) {
+        std::string_view data = line.data;
+        int total = static_cast<int>(data.size());
+        for (size_t i = 0; i < data.size(); i += 2) {
+            if (data[i] == '0' && i + 1 < data.size() && data[i + 1] == '0') {
+                continue;
+            }
+            int tick = GetTicks(line.measure, static_cast<int>(i), total);
+            float bpm = 120;
+            auto it = bpm_definitions_.find(data.substr(i, 2));
+            if (it != bpm_definitions_.end()) {
+                bpm = it->second;
+            }
+            bpms.push_back({tick, bpm});
+        }
+    }
+    std::sort(bpms.begin(), bpms.end(),
+              [](const MMW::BPM& lhs, const MMW::BPM& rhs) {
+                  return lhs.tick < rhs.tick;
+              });
+    return bpms;
+}
+
+std::vector<MMW::HiSpeed> SusTextParser::GetHiSpeeds(
+    const std::vector<DataLine>& lines) const {
+    std::vector<MMW::HiSpeed> hi_speeds;
+    for (const auto& line : lines) {
+        std::string_view data = line.data;
+        size_t first_quote = data.find('"') + 1;
+        size_t last_quote = data.rfind('"');
+        data = data.substr(first_quote, last_quote - first_quote);
+        if (data.empty()) {
+            continue;
+        }
+        // measure'tick:speed
+        for (std::string_view change : Split(data, ',')) {
+            size_t begin = 0;
+            size_t end = change.find('\'');
+            int measure = ToInt(change.substr(begin, end - begin));
+            begin = ++end;
+            end = change.find(':', end);
+            int tick = ToInt(change.substr(begin, end - begin));
+            begin = ++end;
+            float speed = ToDouble(change.substr(begin));
+            hi_speeds.push_back({GetTicks(measure, 0, 1) + tick, speed});
+        }
+    }
+    return hi_speeds;
+}
+
+void SusTextParser::AppendNoteStreams(std::vector<MMW::SUSNote>& stream,
+                                      MMW::SUSNoteStream& streams) {
+    // a stream ends at its end note, notes after the last end are dropped
+    std::stable_sort(stream.begin(), stream.end(),
+                     [](const MMW::SUSNote& lhs, const MMW::SUSNote& rhs) {
+                         return lhs.tick < rhs.tick;
+                     });
+    size_t begin = 0;
+    for (size_t i = 0; i < stream.size(); ++i) {
+        if (stream[i].type == 2) {
+            streams.emplace_back(stream.begin() + begin, stream.begin() + i + 1);
+            begin = i + 1;
+        }
+    }
+}
+
+MMW::SUS SusTextParser::Parse(std::string_view text) {
+    MMW::SUS sus{};
+    std::vector<DataLine> note_lines;
+    std::vector<DataLine> bpm_lines;
+    std::vector<DataLine> hi_speed_lines;
+
+    size_t pos = 0;
+    while (pos < text.size()) {
+        size_t end = std::min(text.find('\n', pos), text.size());
+        std::string_view line = text.substr(pos, end - pos);
+        pos = end + 1;
+        // the original reads in text mode, which drops the CR of CRLF
+        if (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+        line = Trim(line);
+        if (!StartsWith(line, "#")) {
+            continue;
+        }
+        if (IsCommand(line)) {
+            ProcessCommand(line);
+            continue;
+        }
+
+        DataLine data_line = ReadDataLine(line);
+        std::string_view header = data_line.header;
+        if (header.size() != 5 && header.size() != 6) {
+            continue;
+        }
+        if (EndsWith(header, "02") && IsDigits(header)) {
+            sus.barlengths.push_back(
+                {data_line.measure,
+                 static_cast<float>(ToDouble(data_line.data))});
+        } else if (StartsWith(header, "BPM")) {
+            bpm_definitions_[std::string(header.substr(3))] =
+                ToDouble(data_line.data);
+        } else if (EndsWith(header, "08")) {
+            bpm_lines.push_back(data_line);
+        } else if (StartsWith(header, "TIL")) {
+            hi_speed_lines.push_back(data_line);
+        } else {
+            note_lines.push_back(data_line);
+        }
+    }
+
+    // there must be a time signature
+    if (sus.barlengths.empty()) {
+        sus.barlengths.push_back({0, 4.0f});
+    }
+    BuildBars(sus.barlengths);
+    sus.bpms = GetBpms(bpm_lines);
+    sus.hiSpeeds = GetHiSpeeds(hi_speed_lines);
+
+    std::map<int, std::vector<MMW::SUSNote>> slide_streams;
+    std::map<int, std::vector<MMW::SUSNote>> guide_streams;
+    for (const auto& line : note_lines) {
+        std::string_view header = line.header;
+        if (header.size() == 5 && header[3] == '1') {
+            AppendNotes(line, sus.taps);
+        } else if (header.size() == 5 && header[3] == '5') {
+            AppendNotes(line, sus.directionals);
+        } else if (header.size() == 6 && header[3] == '3') {
+            AppendNotes(line, slide_streams[GetBase36Digit(header, 5)]);
+        } else if (header.size() == 6 && header[3] == '9') {
+            AppendNotes(line, guide_streams[GetBase36Digit(header, 5)]);
+        }
+    }
+    for (auto& [channel, stream] : slide_streams) {
+        AppendNoteStreams(stream, sus.slides);
+    }
+    for (auto& [channel, stream] : guide_streams) {
+        AppendNoteStreams(stream, sus.guides);
+    }
+
+    sus.metadata.data["title"] = title_;
+    sus.metadata.data["artist"] = artist_;
+    sus.metadata.data["designer"] = designer_;
+    sus.metadata.waveOffset = wave_offset_;
+    return sus;
+}
+
+} // namespace
+
+namespace psh {
+
+MMW::SUS ParseSus(const std::filesystem::path& path) {
+    MappedFile file;
+    if (!file.Open(path)) {
+        spdlog::warn("Failed to map sus file: {}", path.string());
+        return ParseSusText({});
+    }
+    return ParseSusText(std::string_view(
+        reinterpret_cast<const char*>(file.Data()), file.Size()));
+}
+
+MMW::SUS ParseSusText(std::string_view text) {
+    return SusTextParser().Parse(text);
+}
+
+} // namespace psh
@@ -0,0 +1,23 @@
+#pragma once
+
+#ifndef PSH_SUS_SUS_PARSER_H_
+#define PSH_SUS_SUS_PARSER_H_
+
+#include <filesystem>
+#include <string_view>
+
+#include <MikuMikuWorld/SUS.h>
+
+namespace psh {
+
+// Builds the same SUS as MikuMikuWorld::SusParser without copying the chart.
+// The file is mapped and every token is a view into it, note digits go
+// through a base 36 table and the tick offset of each bar is summed once.
+// Throws std::runtime_error on note digits MikuMikuWorld::SusParser rejects
+// as well. A missing or empty file gives an empty chart like the original.
+MikuMikuWorld::SUS ParseSus(const std::filesystem::path& path);
+MikuMikuWorld::SUS ParseSusText(std::string_view text);
+
+} // namespace psh
+
+#endif // !PSH_SUS_SUS_PARSER_H_
@@ -3,15 +3,30 @@
 #ifndef PSH_TEST_PSH_TEST_HPP_
 #define PSH_TEST_PSH_TEST_HPP_
 
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <optional>
+#include <string>
+
 #include <spdlog/spdlog.h>
+#include <MikuMikuWorld/ScoreConverter.h>
+#include <MikuMikuWorld/SusParser.h>
 
 #include "touch/mini_touch_client.h"
+#include "touch/recording_touch.h"
+#include "touch/dispatch_recorder.h"
 #include "screen/i_screen.h"
+#include "screen/replay_screen.h"
 #include "player/note_finder.h"
 #include "player/auto_player.h"
+#include "player/touch_plan.h"
+#include "player/track_geometry.h"
 #include "mumu/mumu_client.h"
 #include "sus/score_touch.h"
+#include "sus/sus_parser.h"
 #include "common/time_utils.h"
+#include "common/finalizer.hpp"
 
 namespace psh::test {
 
@@ -43,6 +58,223 @@ static void TestTouch() {
     executor.Shutdown(false);
 }
 
+static void BenchmarkNoteFinder(const std::filesystem::path &replay_path,
+                                SpeedFactor speed_factor = SpeedFactor::kSpeed10x) {
+    ReplayScreen screen(replay_path, ReplayScreen::Mode::kFastest);
+    NoteTimeEstimator estimator(speed_factor);
+    NoteFinder finder(estimator, TrackConfig{});
+
+    int frames = 0;
+    size_t notes = 0;
+    int64_t total_ns = 0;
+    int64_t max_ns = 0;
+    while (screen.IsOpened() && !screen.IsFinished()) {
+        Frame frame = screen.GetFrame();
+        int64_t begin_ns = GetCurrentTimeNs();
+        auto found = finder.FindAllNotes(frame);
+        int64_t cost_ns = GetCurrentTimeNs() - begin_ns;
+
+        ++frames;
+        total_ns += cost_ns;
+        max_ns = std::max(max_ns, cost_ns);
+        for (const auto &each : found) {
+            notes += each.second.size();
+        }
+    }
+    if (frames > 0) {
+        spdlog::info("NoteFinder: {} frames, {} notes, avg {:.1f}us, max {:.1f}us",
+                     frames, notes, total_ns / 1000.0 / frames, max_ns / 1000.0);
+    }
+}
+
+static void TestReplayPlay(const std::filesystem::path &replay_path,
+                           const PlayConfig &play_config = PlayConfig{}) {
+    ReplayScreen screen(replay_path);
+    // the main loop has to detect the play screen before any play loop runs
+    if (!screen.IsOpened() || !screen.CoversDisplay()) {
+        spdlog::error("TestReplayPlay needs a replay of the whole display, "
+                      "record with RecordRegion::kDisplay: {}",
+                      replay_path.string());
+        return;
+    }
+    RecordingTouch touch;
+    TouchController controller(touch);
+    AutoPlayer player(controller, screen, TrackConfig{}, play_config);
+    player.Start();
+    while (!screen.IsFinished()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    player.Stop();
+    spdlog::info("Replay finished, {} touch events",
+                 touch.GetRecords().size());
+}
+
+// Plays the whole touch plan of a chart on a VirtualClock against a
+// RecordingTouch, a full chart takes milliseconds. Every press of the plan
+// has to be sent and lifted, each exactly at its planned time.
+static bool TestVirtualChartPlay(const std::filesystem::path &chart_path) {
+    MikuMikuWorld::ScoreConverter converter;
+    MikuMikuWorld::Score score = converter.susToScore(ParseSus(chart_path));
+    HrLine hit_line = TrackGeometry::Get(TrackConfig{})->GetHitLine();
+    TouchPlan plan = BuildTouchPlan(ScoreToTouch(score), hit_line);
+    size_t planned_downs = 0;
+    int64_t start_ns = 0; // slides of the first notes start before 0
+    for (const auto &stream : plan.streams) {
+        for (const auto &task : stream.GetTasks()) {
+            planned_downs += task.action == TouchAction::Down;
+            start_ns = std::min(start_ns, task.execute_time_ns);
+        }
+    }
+
+    VirtualClock clock(start_ns);
+    SetClock(&clock);
+    Finalizer restore_clock([]() { SetClock(nullptr); });
+
+    RecordingTouch touch;
+    TouchController controller(touch);
+    // large enough to keep every dispatch of a chart
+    auto recorder = std::make_shared<DispatchRecorder>(1 << 20);
+    DispatchStats stats;
+    auto begin = std::chrono::steady_clock::now();
+    {
+        TouchExecutor executor = controller.CreateExecutor();
+        executor.SetRecorder(recorder);
+        for (const auto &stream : plan.streams) {
+            executor.Execute(stream);
+        }
+        executor.Start();
+        executor.Shutdown(false);
+        stats = executor.GetDispatchStats();
+    }
+    std::chrono::duration<double, std::milli> wall =
+        std::chrono::steady_clock::now() - begin;
+
+    auto records = touch.GetRecords();
+    size_t downs = 0;
+    size_t ups = 0;
+    for (const auto &record : records) {
+        downs += record.action == TouchAction::Down;
+        ups += record.action == TouchAction::Up;
+    }
+    DispatchReport report = DispatchRecorder::Summarize(recorder->Snapshot());
+    spdlog::info("Virtual play: {} streams, {} touch events, {} dispatched, "
+                 "{}ms of chart in {:.1f}ms, late max: {}ns",
+                 plan.streams.size(), records.size(),
+                 recorder->GetRecordedCount(),
+                 NsToMs(GetCurrentTimeNs() - start_ns),
+                 wall.count(), report.late_max_ns);
+
+    bool passed = downs == planned_downs && ups == downs &&
+                  recorder->GetRecordedCount() == records.size() &&
+                  report.late_max_ns == 0 && stats.dropped == 0 &&
+                  stats.preempted == 0;
+    if (!passed) {
+        spdlog::error("Virtual play failed: {} of {} presses, {} lifts, "
+                      "preempted: {}, dropped: {}",
+                      downs, planned_downs, ups, stats.preempted,
+                      stats.dropped);
+    }
+    return passed;
+}
+
+static bool SameSusNotes(const std::vector<MikuMikuWorld::SUSNote> &lhs,
+                         const std::vector<MikuMikuWorld::SUSNote> &rhs) {
+    return std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(),
+                      [](const auto &a, const auto &b) {
+                          return a.tick == b.tick && a.lane == b.lane &&
+                                 a.width == b.width && a.type == b.type;
+                      });
+}
+
+// name of the first field that differs, empty when both are identical
+static std::string DiffSus(const MikuMikuWorld::SUS &lhs,
+                           const MikuMikuWorld::SUS &rhs) {
+    if (lhs.metadata.data != rhs.metadata.data ||
+        lhs.metadata.requests != rhs.metadata.requests) {
+        return "metadata";
+    }
+    if (lhs.metadata.waveOffset != rhs.metadata.waveOffset ||
+        lhs.metadata.movieOffset != rhs.metadata.movieOffset ||
+        lhs.metadata.baseBPM != rhs.metadata.baseBPM) {
+        return "metadata offsets";
+    }
+    if (!SameSusNotes(lhs.taps, rhs.taps)) {
+        return "taps";
+    }
+    if (!SameSusNotes(lhs.directionals, rhs.directionals)) {
+        return "directionals";
+    }
+    if (!std::equal(lhs.slides.begin(), lhs.slides.end(), rhs.slides.begin(),
+                    rhs.slides.end(), SameSusNotes)) {
+        return "slides";
+    }
+    if (!std::equal(lhs.guides.begin(), lhs.guides.end(), rhs.guides.begin(),
+                    rhs.guides.end(), SameSusNotes)) {
+        return "guides";
+    }
+    if (!std::equal(lhs.bpms.begin(), lhs.bpms.end(), rhs.bpms.begin(),
+                    rhs.bpms.end(), [](const auto &a, const auto &b) {
+                        return a.tick == b.tick && a.bpm == b.bpm;
+                    })) {
+        return "bpms";
+    }
+    if (!std::equal(lhs.barlengths.begin(), lhs.barlengths.end(),
+                    rhs.barlengths.begin(), rhs.barlengths.end(),
+                    [](const auto &a, const auto &b) {
+                        return a.bar == b.bar && a.length == b.length;
+                    })) {
+        return "barlengths";
+    }
+    if (!std::equal(lhs.hiSpeeds.begin(), lhs.hiSpeeds.end(),
+                    rhs.hiSpeeds.begin(), rhs.hiSpeeds.end(),
+                    [](const auto &a, const auto &b) {
+                        return a.tick == b.tick && a.speed == b.speed;
+                    })) {
+        return "hiSpeeds";
+    }
+    return {};
+}
+
+// Parses every .sus file below chart_dir with MikuMikuWorld::SusParser and
+// ParseSus, both must give the same SUS or both throw. Returns the number
+// of charts they disagree on.
+static int CompareSusParsers(const std::filesystem::path &chart_dir) {
+    int charts = 0;
+    int mismatches = 0;
+    for (const auto &entry :
+         std::filesystem::recursive_directory_iterator(chart_dir)) {
+        if (!entry.is_regular_file() || entry.path().extension() != ".sus") {
+            continue;
+        }
+        ++charts;
+        std::optional<MikuMikuWorld::SUS> expected;
+        std::optional<MikuMikuWorld::SUS> actual;
+        try {
+            MikuMikuWorld::SusParser parser;
+            expected = parser.parse(entry.path().u8string());
+        } catch (const std::exception &) {
+        }
+        try {
+            actual = ParseSus(entry.path());
+        } catch (const std::exception &) {
+        }
+
+        std::string diff;
+        if (expected.has_value() != actual.has_value()) {
+            diff = expected ? "ParseSus threw" : "SusParser threw";
+        } else if (expected) {
+            diff = DiffSus(*expected, *actual);
+        }
+        if (!diff.empty()) {
+            ++mismatches;
+            spdlog::error("SUS parsers differ in {}: {}", diff,
+                          entry.path().string());
+        }
+    }
+    spdlog::info("Compared {} charts, {} differ", charts, mismatches);
+    return mismatches;
+}
+
 } // namespace psh::test
 
 #endif // !PSH_TEST_PSH_TEST_HPP_
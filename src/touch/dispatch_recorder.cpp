@@ -0,0 +1,162 @@
+#include "touch/dispatch_recorder.h"
+
+#include <algorithm>
+#include <fstream>
+
+#include <spdlog/spdlog.h>
+
+namespace {
+
+// nearest-rank percentile, sorts values partially
+int64_t Percentile(std::vector<int64_t>& values, double ratio) {
+    if (values.empty()) {
+        return 0;
+    }
+    size_t rank = static_cast<size_t>(ratio * (values.size() - 1) + 0.5);
+    std::nth_element(values.begin(), values.begin() + rank, values.end());
+    return values[rank];
+}
+
+const char* ActionName(psh::TouchAction action) {
+    switch (action) {
+        case psh::TouchAction::Down:
+            return "down";
+        case psh::TouchAction::Up:
+            return "up";
+        case psh::TouchAction::Move:
+        default:
+            return "move";
+    }
+}
+
+} // namespace
+
+namespace psh {
+
+std::string DispatchReport::FormatHistogram() const {
+    std::string result;
+    for (size_t i = 0; i < histogram.size(); ++i) {
+        if (histogram[i] == 0) {
+            continue;
+        }
+        double begin_ms = i * kHistogramBucketUs / 1000.0;
+        if (i + 1 == histogram.size()) {
+            result += fmt::format("  >={:.2f}ms: {}\n", begin_ms, histogram[i]);
+        } else {
+            result += fmt::format("  {:.2f}-{:.2f}ms: {}\n", begin_ms,
+                                  begin_ms + kHistogramBucketUs / 1000.0,
+                                  histogram[i]);
+        }
+    }
+    return result;
+}
+
+DispatchRecorder::DispatchRecorder(size_t capacity) {
+    size_t size = 1;
+    while (size < capacity) {
+        size <<= 1;
+    }
+    ring_.resize(size);
+    mask_ = size - 1;
+}
+
+void DispatchRecorder::Record(const DispatchRecord& record) {
+    uint64_t head = head_.load(std::memory_order_relaxed);
+    ring_[head & mask_] = record;
+    head_.store(head + 1, std::memory_order_release);
+}
+
+std::vector<DispatchRecord> DispatchRecorder::Snapshot() const {
+    uint64_t head = head_.load(std::memory_order_acquire);
+    uint64_t begin = head > ring_.size() ? head - ring_.size() : 0;
+    std::vector<DispatchRecord> records;
+    records.reserve(head - begin);
+    for (uint64_t i = begin; i < head; ++i) {
+        records.push_back(ring_[i & mask_]);
+    }
+    // the writer may have lapped the oldest entries while they were copied,
+    // it could be writing index new_head right now
+    uint64_t new_head = head_.load(std::memory_order_acquire);
+    if (new_head + 1 > begin + ring_.size()) {
+        uint64_t skip = std::min<uint64_t>(
+            new_head + 1 - ring_.size() - begin, records.size());
+        records.erase(records.begin(), records.begin() + skip);
+    }
+    return records;
+}
+
+DispatchReport DispatchRecorder::Summarize(
+    const std::vector<DispatchRecord>& records) {
+    DispatchReport report;
+    report.count = records.size();
+    report.histogram.assign(DispatchReport::kHistogramBuckets, 0);
+    if (records.empty()) {
+        return report;
+    }
+
+    std::vector<int64_t> late, call;
+    late.reserve(records.size());
+    call.reserve(records.size());
+    for (const auto& record : records) {
+        late.push_back(record.GetLateNs());
+        call.push_back(record.GetCallNs());
+        int64_t bucket =
+            record.GetLateNs() / (DispatchReport::kHistogramBucketUs * 1000);
+        bucket = std::clamp<int64_t>(bucket, 0,
+                                     DispatchReport::kHistogramBuckets - 1);
+        ++report.histogram[bucket];
+    }
+    report.late_p50_ns = Percentile(late, 0.50);
+    report.late_p95_ns = Percentile(late, 0.95);
+    report.late_p99_ns = Percentile(late, 0.99);
+    report.late_max_ns = *std::max_element(late.begin(), late.end());
+    report.call_p50_ns = Percentile(call, 0.50);
+    report.call_p99_ns = Percentile(call, 0.99);
+    report.call_max_ns = *std::max_element(call.begin(), call.end());
+    return report;
+}
+
+bool DispatchRecorder::ExportCsv(const std::filesystem::path& path,
+                                 const std::vector<DispatchRecord>& records) {
+    std::ofstream file(path);
+    if (!file.is_open()) {
+        spdlog::error("Failed to open dispatch csv: {}", path.string());
+        return false;
+    }
+    file << "planned_ns,dispatch_ns,done_ns,action,late_us,call_us\n";
+    for (const auto& record : records) {
+        file << record.planned_ns << ',' << record.dispatch_ns << ','
+             << record.done_ns << ',' << ActionName(record.action) << ','
+             << record.GetLateNs() / 1000.0 << ','
+             << record.GetCallNs() / 1000.0 << '\n';
+    }
+    return file.good();
+}
+
+bool DispatchRecorder::ExportJson(const std::filesystem::path& path,
+                                  const DispatchReport& report) {
+    std::ofstream file(path);
+    if (!file.is_open()) {
+        spdlog::error("Failed to open dispatch json: {}", path.string());
+        return false;
+    }
+    file << "{\n"
+         << "  \"count\": " << report.count << ",\n"
+         << "  \"late_ns\": {\"p50\": " << report.late_p50_ns
+         << ", \"p95\": " << report.late_p95_ns
+         << ", \"p99\": " << report.late_p99_ns
+         << ", \"max\": " << report.late_max_ns << "},\n"
+         << "  \"call_ns\": {\"p50\": " << report.call_p50_ns
+         << ", \"p99\": " << report.call_p99_ns
+         << ", \"max\": " << report.call_max_ns << "},\n"
+         << "  \"histogram_bucket_us\": " << DispatchReport::kHistogramBucketUs
+         << ",\n"
+         << "  \"histogram\": [";
+    for (size_t i = 0; i < report.histogram.size(); ++i) {
+        file << (i == 0 ? "" : ", ") << report.histogram[i];
+    }
+    file << "]\n}\n";
+    return file.good();
+}
+
+} // namespace psh
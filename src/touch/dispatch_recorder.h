@@ -0,0 +1,76 @@
+#pragma once
+
+#ifndef PSH_TOUCH_DISPATCH_RECORDER_H_
+#define PSH_TOUCH_DISPATCH_RECORDER_H_
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "touch/i_touch.h"
+
+namespace psh {
+
+struct DispatchRecord {
+    int64_t planned_ns;  // execute time of the task
+    int64_t dispatch_ns; // ITouch call started
+    int64_t done_ns;     // ITouch call returned
+    TouchAction action;
+
+    int64_t GetLateNs() const { return dispatch_ns - planned_ns; }
+    int64_t GetCallNs() const { return done_ns - dispatch_ns; }
+};
+
+struct DispatchReport {
+    // clang-format off
+    static constexpr int kHistogramBucketUs = 250;
+    static constexpr int kHistogramBuckets  = 21;   // last one is open ended
+    // clang-format on
+
+    size_t count = 0;
+    int64_t late_p50_ns = 0;
+    int64_t late_p95_ns = 0;
+    int64_t late_p99_ns = 0;
+    int64_t late_max_ns = 0;
+    int64_t call_p50_ns = 0;
+    int64_t call_p99_ns = 0;
+    int64_t call_max_ns = 0;
+    std::vector<size_t> histogram; // lateness
+
+    std::string FormatHistogram() const;
+};
+
+// Keeps the latest task dispatches of a TouchExecutor in a ring buffer. The
+// touch thread is the only writer and never blocks, Snapshot may run at the
+// same time and skips entries overwritten while it copied them.
+class DispatchRecorder {
+public:
+    static constexpr size_t kDefaultCapacity = 1 << 14;
+
+    // capacity is rounded up to a power of two
+    explicit DispatchRecorder(size_t capacity = kDefaultCapacity);
+
+    void Record(const DispatchRecord& record);
+    // recorded entries in dispatch order
+    std::vector<DispatchRecord> Snapshot() const;
+    uint64_t GetRecordedCount() const {
+        return head_.load(std::memory_order_acquire);
+    }
+
+    static DispatchReport Summarize(const std::vector<DispatchRecord>& records);
+    static bool ExportCsv(const std::filesystem::path& path,
+                          const std::vector<DispatchRecord>& records);
+    static bool ExportJson(const std::filesystem::path& path,
+                           const DispatchReport& report);
+
+private:
+    std::vector<DispatchRecord> ring_;
+    size_t mask_;
+    std::atomic<uint64_t> head_{0};
+};
+
+} // namespace psh
+
+#endif // !PSH_TOUCH_DISPATCH_RECORDER_H_
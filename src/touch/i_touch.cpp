@@ -1,11 +1,15 @@
 #include "i_touch.h"
 
+#include <algorithm>
 #include <thread>
 #include <cmath>
+#include <utility>
 
 #include <spdlog/spdlog.h>
 
+#include "common/thread_utils.h"
 #include "common/time_utils.h"
+#include "touch/dispatch_recorder.h"
 
 namespace {
 
@@ -22,6 +26,17 @@ int Lerp(int a, int b, double t) { return static_cast<int>(a + (b - a) * t); };
 
 namespace psh {
 
+cv::Point TouchTask::GetPosAt(int64_t elapsed_ns) const {
+    if (elapsed_ns >= duration_ns) {
+        return pos;
+    }
+    double progress = CubicSpline(
+        slope_in, slope_out,
+        static_cast<double>(std::max<int64_t>(elapsed_ns, 0)) / duration_ns);
+    return cv::Point{Lerp(from.x, pos.x, progress),
+                     Lerp(from.y, pos.y, progress)};
+}
+
 void TouchTaskStream::AddTask(int64_t execute_time_ms, TouchAction action,
                               cv::Point pos) {
     if (tasks_.empty()) {
@@ -45,23 +60,25 @@ void TouchTaskStream::AddTap(int64_t execute_time_ms, cv::Point pos,
     AddTask(execute_time_ms + duration_ms, TouchAction::Up, {});
 }
 
+void TouchTaskStream::AddMotion(int64_t execute_time_ms, cv::Point from,
+                                cv::Point to, int duration_ms, double slope_in,
+                                double slope_out) {
+    AddTask(execute_time_ms, TouchAction::Move, to);
+    TouchTask& task = tasks_.back();
+    task.duration_ns = MsToNs(std::max(duration_ms, 0));
+    task.from = from;
+    task.slope_in = static_cast<float>(slope_in);
+    task.slope_out = static_cast<float>(slope_out);
+}
+
 void TouchTaskStream::AddSlide(int64_t execute_time_ms, cv::Point from,
-                               cv::Point to, int duration_ms, int step_delay_ms,
-                               double slope_in, double slope_out,
-                               bool touch_down, bool touch_up) {
+                               cv::Point to, int duration_ms, double slope_in,
+                               double slope_out, bool touch_down,
+                               bool touch_up) {
     if (touch_down) {
         AddTask(execute_time_ms, TouchAction::Down, from);
     }
-    for (int64_t cur_duration = step_delay_ms; cur_duration < duration_ms;
-         cur_duration += step_delay_ms) {
-        double progress =
-            CubicSpline(slope_in, slope_out,
-                        static_cast<double>(cur_duration) / duration_ms);
-        int cur_x = static_cast<int>(Lerp(from.x, to.x, progress));
-        int cur_y = static_cast<int>(Lerp(from.y, to.y, progress));
-        AddTask(execute_time_ms + cur_duration, TouchAction::Move,
-                cv::Point{cur_x, cur_y});
-    }
+    AddMotion(execute_time_ms, from, to, duration_ms, slope_in, slope_out);
     if (touch_up) {
         AddTask(execute_time_ms + duration_ms, TouchAction::Up, {});
     }
@@ -74,6 +91,21 @@ void TouchExecutor::SetBaseTime(int64_t base_time_ms) {
     cv_.notify_one();
 }
 
+void TouchExecutor::SetThreadConfig(const TouchThreadConfig &config) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    thread_config_ = config;
+}
+
+DispatchStats TouchExecutor::GetDispatchStats() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return dispatch_stats_;
+}
+
+void TouchExecutor::SetRecorder(std::shared_ptr<DispatchRecorder> recorder) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    recorder_ = std::move(recorder);
+}
+
 bool TouchExecutor::Start() {
     int expected = kStop;
     if (touch_thread_.joinable() ||
@@ -95,12 +127,13 @@ void TouchExecutor::Shutdown(bool force) {
         Stop();
     }
     std::lock_guard<std::mutex> lock(mutex_);
-    for (const int slot : slots_) {
-        touch_.TouchUp(slot);
-    }
-    while (!touch_tasks_.empty()) {
-        touch_tasks_.pop();
+    for (const auto &[id, contact] : contacts_) {
+        if (contact.slot != -1) {
+            touch_.TouchUp(contact.slot);
+        }
     }
+    contacts_.clear();
+    touch_tasks_->Clear();
 }
 
 void TouchExecutor::Stop() {
@@ -111,84 +144,254 @@ void TouchExecutor::Stop() {
     }
 }
 
-void TouchExecutor::Execute(std::unique_ptr<TouchTaskStream> task_stream) {
+TouchHandle TouchExecutor::Execute(
+    std::unique_ptr<TouchTaskStream> task_stream) {
+    return Execute(std::move(*task_stream));
+}
+
+TouchHandle TouchExecutor::Execute(const TouchTaskStream &task_stream) {
+    auto stream = stream_pool_.Acquire();
+    stream->tasks_ = task_stream.tasks_;
+    stream->priority_ = task_stream.priority_;
+    return Submit(std::move(stream));
+}
+
+TouchHandle TouchExecutor::Execute(TouchTaskStream &&task_stream) {
+    // the pooled storage goes to task_stream, the pool keeps its buffer
+    auto stream = stream_pool_.Acquire();
+    stream->tasks_.swap(task_stream.tasks_);
+    stream->priority_ = task_stream.priority_;
+    return Submit(std::move(stream));
+}
+
+TouchHandle TouchExecutor::TouchTap(int64_t execute_time_ms, cv::Point pos,
+                                    int duration_ms) {
+    auto stream = stream_pool_.Acquire();
+    stream->AddTap(execute_time_ms, pos, duration_ms);
+    return Submit(std::move(stream));
+}
+
+TouchHandle TouchExecutor::TouchSlide(int64_t execute_time_ms, cv::Point from,
+                                      cv::Point to, int duration_ms,
+                                      double slope_in, double slope_out) {
+    auto stream = stream_pool_.Acquire();
+    stream->AddSlide(execute_time_ms, from, to, duration_ms, slope_in,
+                     slope_out);
+    return Submit(std::move(stream));
+}
+
+int64_t TouchExecutor::GetExecuteTime(const ScheduledStream &entry) const {
+    return base_time_ns_ + entry.execute_time_ns;
+}
+
+bool TouchExecutor::IsStale(const ScheduledStream &entry) {
+    return entry.version != entry.stream->version_ ||
+           entry.stream->cancelled_;
+}
+
+TouchHandle TouchExecutor::Submit(
+    std::shared_ptr<TouchTaskStream> task_stream) {
     if (task_stream->Empty()) {
-        return;
+        return {};
     }
     std::lock_guard<std::mutex> lock(mutex_);
-    bool notify = touch_tasks_.empty() ||
-                  task_stream->GetCurrent().execute_time_ns <
-                      touch_tasks_.top()->GetCurrent().execute_time_ns;
-    touch_tasks_.push(std::move(task_stream));
+    Schedule(task_stream);
+    return TouchHandle(this, task_stream);
+}
+
+void TouchExecutor::Schedule(std::shared_ptr<TouchTaskStream> task_stream) {
+    int64_t execute_time_ns = task_stream->GetNextTimeNs();
+    bool notify = touch_tasks_->Empty() ||
+                  execute_time_ns < touch_tasks_->Top().execute_time_ns;
+    uint32_t version = task_stream->version_;
+    touch_tasks_->Push(
+        ScheduledStream{execute_time_ns, version, std::move(task_stream)});
     if (notify) {
         cv_.notify_all();
     }
 }
 
-void TouchExecutor::Execute(const TouchTaskStream &task_stream) {
-    Execute(std::make_unique<TouchTaskStream>(task_stream));
-}
-
-void TouchExecutor::Execute(TouchTaskStream &&task_stream) {
-    Execute(std::make_unique<TouchTaskStream>(std::move(task_stream)));
+bool TouchExecutor::IsPending(const TouchTaskStream &task_stream) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return task_stream.cur_index_ == 0 && !task_stream.cancelled_;
 }
 
-void TouchExecutor::TouchTap(int64_t execute_time_ms, cv::Point pos,
-                             int duration_ms) {
-    auto task_stream = std::make_unique<TouchTaskStream>();
-    task_stream->AddTap(execute_time_ms, pos, duration_ms);
-    Execute(std::move(task_stream));
+int64_t TouchExecutor::GetExecuteTimeMs(const TouchTaskStream &task_stream) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return NsToMs(task_stream.tasks_.front().execute_time_ns);
 }
 
-void TouchExecutor::TouchSlide(int64_t execute_time_ms, cv::Point from,
-                               cv::Point to, int duration_ms, int step_delay_ms,
-                               double slope_in, double slope_out) {
-    auto task_stream = std::make_unique<TouchTaskStream>();
-    task_stream->AddSlide(execute_time_ms, from, to, duration_ms, step_delay_ms,
-                          slope_in, slope_out);
-    Execute(std::move(task_stream));
+bool TouchExecutor::Reschedule(
+    const std::shared_ptr<TouchTaskStream> &task_stream,
+    int64_t execute_time_ms) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (task_stream->cur_index_ != 0 || task_stream->cancelled_) {
+        return false;
+    }
+    int64_t delta_ns =
+        MsToNs(execute_time_ms) - task_stream->tasks_.front().execute_time_ns;
+    for (auto &task : task_stream->tasks_) {
+        task.execute_time_ns += delta_ns;
+    }
+    ++task_stream->version_;
+    Schedule(task_stream);
+    return true;
 }
 
-int64_t TouchExecutor::GetExecuteTime(const TouchTaskStream &task) const {
-    return base_time_ns_ + task.GetCurrent().execute_time_ns;
+bool TouchExecutor::Cancel(TouchTaskStream &task_stream) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (task_stream.cur_index_ != 0 || task_stream.cancelled_) {
+        return false;
+    }
+    task_stream.cancelled_ = true;
+    return true;
 }
 
 void TouchExecutor::ProcessTouch(TouchTaskStream &task_stream,
                                  int64_t cur_time_ns) {
+    const int64_t motion_ns =
+        std::max(thread_config_.motion_us, 1) * int64_t{1000};
     do {
         const auto &curr = task_stream.GetCurrent();
+        int64_t planned_ns = base_time_ns_ + task_stream.GetNextTimeNs();
+        int64_t dispatch_ns = GetCurrentTimeNs();
+        int64_t elapsed_ns = 0;
+        bool sent = true;
         switch (curr.action) {
             case TouchAction::Down: {
-                int slot = touch_.TouchDown(curr.pos);
-                if (slot == -1) {
+                int contact_id =
+                    PressContact(curr.pos, task_stream.priority_);
+                if (contact_id == -1) {
                     task_stream.cur_index_ = task_stream.tasks_.size();
                     return;
-                } else {
-                    task_stream.slot_index_ = slot;
                 }
-                slots_.insert(slot);
+                task_stream.contact_id_ = contact_id;
                 break;
             }
-            case TouchAction::Up: {
-                int slot = task_stream.slot_index_;
-                touch_.TouchUp(slot);
-                slots_.erase(slot);
+            case TouchAction::Up:
+                ReleaseContact(task_stream.contact_id_);
                 break;
-            }
             case TouchAction::Move:
-                touch_.TouchMove(task_stream.slot_index_, curr.pos);
+                elapsed_ns =
+                    cur_time_ns - base_time_ns_ - curr.execute_time_ns;
+                // the first position of a slide repeats its Down and flat
+                // segments of a hold repeat the last one
+                sent = MoveContact(task_stream.contact_id_,
+                                   curr.GetPosAt(elapsed_ns));
                 break;
         }
+        if (recorder_ && sent) {
+            recorder_->Record(DispatchRecord{planned_ns, dispatch_ns,
+                                             GetCurrentTimeNs(), curr.action});
+        }
+        if (elapsed_ns < curr.duration_ns) {
+            // stay on the motion until its end position was sent
+            task_stream.motion_offset_ns_ =
+                std::min(elapsed_ns + motion_ns, curr.duration_ns);
+            return;
+        }
         task_stream.Next();
     } while (task_stream.HasNext() &&
-             cur_time_ns >= GetExecuteTime(task_stream));
+             cur_time_ns >= base_time_ns_ + task_stream.GetNextTimeNs());
+}
+
+int TouchExecutor::PressContact(cv::Point pos, TouchPriority priority) {
+    int slot = touch_.TouchDown(pos);
+    if (slot == -1 && PreemptContact(priority)) {
+        slot = touch_.TouchDown(pos);
+    }
+    if (slot == -1) {
+        ++dispatch_stats_.dropped;
+        spdlog::warn("No slot for touch at ({}, {}), dropped", pos.x, pos.y);
+        return -1;
+    }
+    int contact_id = next_contact_id_++;
+    contacts_.emplace(contact_id, Contact{slot, pos, priority});
+    return contact_id;
+}
+
+bool TouchExecutor::MoveContact(int contact_id, cv::Point pos) {
+    auto it = contacts_.find(contact_id);
+    if (it == contacts_.end() || it->second.pos == pos) {
+        return false;
+    }
+    it->second.pos = pos;
+    if (it->second.slot == -1) {
+        return false;
+    }
+    touch_.TouchMove(it->second.slot, pos);
+    return true;
+}
+
+void TouchExecutor::ReleaseContact(int contact_id) {
+    auto it = contacts_.find(contact_id);
+    if (it == contacts_.end()) {
+        return;
+    }
+    int slot = it->second.slot;
+    contacts_.erase(it);
+    if (slot != -1) {
+        touch_.TouchUp(slot);
+        ResumeContact();
+    }
+}
+
+bool TouchExecutor::PreemptContact(TouchPriority priority) {
+    if (priority == TouchPriority::kParked) {
+        return false;
+    }
+    // lifting a tap or a hold breaks its note, only parked contacts give way
+    Contact *victim = nullptr;
+    for (auto &[id, contact] : contacts_) {
+        if (contact.slot != -1 && contact.priority == TouchPriority::kParked) {
+            victim = &contact;
+            break;
+        }
+    }
+    if (victim == nullptr) {
+        return false;
+    }
+    touch_.TouchUp(victim->slot);
+    victim->slot = -1;
+    ++dispatch_stats_.preempted;
+    return true;
+}
+
+void TouchExecutor::ResumeContact() {
+    Contact *next = nullptr;
+    for (auto &[id, contact] : contacts_) {
+        if (contact.slot == -1 &&
+            (next == nullptr || contact.priority > next->priority)) {
+            next = &contact;
+        }
+    }
+    if (next == nullptr) {
+        return;
+    }
+    next->slot = touch_.TouchDown(next->pos);
+}
+
+void TouchExecutor::ConfigureThread() {
+    if (thread_config_.realtime && !SetCurrentThreadRealtime()) {
+        spdlog::warn("Failed to raise touch thread priority");
+    }
+    if (thread_config_.cpu >= 0 &&
+        !SetCurrentThreadAffinity(thread_config_.cpu)) {
+        spdlog::warn("Failed to pin touch thread to cpu {}",
+                     thread_config_.cpu);
+    }
 }
 
 void TouchExecutor::ProcessTouchTasksLoop() {
     std::unique_lock<std::mutex> lock(mutex_);
+    ConfigureThread();
+    IClock &clock = GetClock();
+    const int64_t spin_ns =
+        clock.WakesOnTime() ? 0 : thread_config_.spin_us * int64_t{1000};
+    const int64_t batch_ns = thread_config_.batch_us * int64_t{1000};
     int run_flag;
     while ((run_flag = run_flag_.load(std::memory_order_acquire)) != kStop) {
-        if (touch_tasks_.empty()) {
+        if (touch_tasks_->Empty()) {
             if (run_flag == kShutdown) {
                 return;
             }
@@ -196,102 +399,226 @@ void TouchExecutor::ProcessTouchTasksLoop() {
             continue;
         }
 
-        int64_t cur_time_ns = GetCurrentTimeNs();
-        if (GetExecuteTime(*touch_tasks_.top()) > cur_time_ns) {
-            cv_.wait_for(
-                lock, std::chrono::nanoseconds(
-                          GetExecuteTime(*touch_tasks_.top()) - cur_time_ns));
+        if (IsStale(touch_tasks_->Top())) {
+            touch_tasks_->Pop();
+            continue;
+        }
+
+        int64_t cur_time_ns = clock.NowNs();
+        int64_t execute_time_ns = GetExecuteTime(touch_tasks_->Top());
+        int64_t wait_ns = execute_time_ns - cur_time_ns;
+        if (wait_ns > spin_ns) {
+            // sleeps tend to overshoot, wake up spin_ns early and spin
+            clock.WaitUntilNs(lock, cv_, execute_time_ns - spin_ns);
+            continue;
+        }
+        if (wait_ns > 0) {
+            // let Execute schedule earlier streams while spinning
+            lock.unlock();
+            std::this_thread::yield();
+            lock.lock();
             continue;
         }
 
+        // tasks due within batch_ns after the first one are sent early in
+        // the same frame
+        cur_time_ns += batch_ns;
+        touch_.BeginFrame();
         do {
-            std::shared_ptr<TouchTaskStream> task_stream = touch_tasks_.top();
-            touch_tasks_.pop();
-            ProcessTouch(*task_stream, cur_time_ns);
-            if (task_stream->HasNext()) {
-                touch_tasks_.push(std::move(task_stream));
+            ScheduledStream entry = touch_tasks_->Pop();
+            if (IsStale(entry)) {
+                continue;
             }
-        } while (!touch_tasks_.empty() &&
-                 GetExecuteTime(*touch_tasks_.top()) <=
-                     (cur_time_ns = GetCurrentTimeNs()));
+            ProcessTouch(*entry.stream, cur_time_ns);
+            if (entry.stream->HasNext()) {
+                Schedule(std::move(entry.stream));
+            }
+        } while (!touch_tasks_->Empty() &&
+                 GetExecuteTime(touch_tasks_->Top()) <=
+                     (cur_time_ns = clock.NowNs() + batch_ns));
+        touch_.CommitFrame();
     }
 }
 
+bool TouchHandle::IsPending() const {
+    auto stream = stream_.lock();
+    return stream && executor_->IsPending(*stream);
+}
+
+int64_t TouchHandle::GetExecuteTimeMs() const {
+    auto stream = stream_.lock();
+    return stream ? executor_->GetExecuteTimeMs(*stream) : -1;
+}
+
+bool TouchHandle::Reschedule(int64_t execute_time_ms) {
+    auto stream = stream_.lock();
+    return stream && executor_->Reschedule(stream, execute_time_ms);
+}
+
+bool TouchHandle::Cancel() {
+    auto stream = stream_.lock();
+    return stream && executor_->Cancel(*stream);
+}
+
 TouchController::TouchController(ITouch &touch) : touch_(touch) {
+    for (auto &pos : slot_pos_) {
+        pos.store(PackPos(kUnusedSlotPos), std::memory_order_relaxed);
+    }
     for (int slot : touch.GetSupportedSlots()) {
-        unused_slots_.push(slot);
-        slot_pos_map_[slot] = kUnusedSlotPos;
+        if (slot < 0 || slot >= kMaxSlots) {
+            spdlog::warn("Slot {} exceeds the slot table", slot);
+            continue;
+        }
+        supported_mask_ |= 1u << slot;
     }
+    free_mask_.store(supported_mask_, std::memory_order_release);
 }
 
-TouchExecutor TouchController::CreateExecutor() { return TouchExecutor(*this); }
+void TouchController::BeginFrame() {
+    std::lock_guard<std::mutex> lock(touch_mutex_);
+    touch_.BeginFrame();
+    in_frame_ = true;
+}
+
+void TouchController::CommitFrame() {
+    std::lock_guard<std::mutex> lock(touch_mutex_);
+    touch_.CommitFrame();
+    in_frame_ = false;
+    free_mask_.fetch_or(std::exchange(released_in_frame_, 0),
+                        std::memory_order_release);
+}
+
+TouchExecutor TouchController::CreateExecutor(TouchSchedulerType scheduler) {
+    return TouchExecutor(*this, scheduler);
+}
 
 std::vector<cv::Point> TouchController::GetCurrentTouchPoints() {
+    std::array<uint64_t, kMaxSlots> packed;
+    while (true) {
+        uint32_t seq = seq_.load(std::memory_order_acquire);
+        if ((seq & 1) == 0) {
+            for (int i = 0; i < kMaxSlots; ++i) {
+                packed[i] = slot_pos_[i].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (seq_.load(std::memory_order_relaxed) == seq) {
+                break;
+            }
+        }
+        std::this_thread::yield();
+    }
     std::vector<cv::Point> points;
-    std::lock_guard<std::mutex> lock(mutex_);
-    for (const auto &pair : slot_pos_map_) {
-        if (pair.second != kUnusedSlotPos) {
-            points.push_back(pair.second);
+    for (uint64_t each : packed) {
+        cv::Point pos = UnpackPos(each);
+        if (pos != kUnusedSlotPos) {
+            points.push_back(pos);
         }
     }
     return points;
 }
 
 int TouchController::TouchDown(cv::Point pos) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    if (unused_slots_.empty()) {
-        spdlog::warn("No available slots for touch");
-        return -1;
+    int slot = AcquireSlot();
+    {
+        std::lock_guard<std::mutex> lock(touch_mutex_);
+        if (slot == -1 && released_in_frame_ != 0) {
+            // the lifts must reach the device before their slots are
+            // pressed again
+            touch_.CommitFrame();
+            touch_.BeginFrame();
+            free_mask_.fetch_or(std::exchange(released_in_frame_, 0),
+                                std::memory_order_release);
+            slot = AcquireSlot();
+        }
+        if (slot == -1) {
+            return -1;
+        }
+        touch_.TouchDown(slot, pos);
+        StorePos(slot, pos);
     }
-    int slot = unused_slots_.front();
-    touch_.TouchDown(slot, pos);
-    unused_slots_.pop();
-    slot_pos_map_[slot] = pos;
-    spdlog::debug("Touch down at slot {} position ({}, {})", slot, pos.x,
-                  pos.y);
     return slot;
 }
 
 void TouchController::TouchUp(int slot) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    auto it = slot_pos_map_.find(slot);
-    if (it == slot_pos_map_.end()) {
-        spdlog::warn("Slot {} is not supported", slot);
-        return;
-    }
-    if (it->second == kUnusedSlotPos) {
-        spdlog::warn("Slot {} is not in use", slot);
+    std::lock_guard<std::mutex> lock(touch_mutex_);
+    if (!CheckSlotInUse(slot)) {
         return;
     }
     touch_.TouchUp(slot);
-    it->second = kUnusedSlotPos;
-    unused_slots_.push(slot);
-    spdlog::debug("Touch up at slot {}", slot);
+    StorePos(slot, kUnusedSlotPos);
+    if (in_frame_) {
+        released_in_frame_ |= 1u << slot;
+    } else {
+        free_mask_.fetch_or(1u << slot, std::memory_order_release);
+    }
 }
 
 void TouchController::TouchMove(int slot, cv::Point pos) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    auto it = slot_pos_map_.find(slot);
-    if (it == slot_pos_map_.end()) {
-        spdlog::warn("Slot {} is not supported", slot);
-        return;
-    }
-    if (it->second == kUnusedSlotPos) {
-        spdlog::warn("Slot {} is not in use", slot);
+    std::lock_guard<std::mutex> lock(touch_mutex_);
+    if (!CheckSlotInUse(slot)) {
         return;
     }
     touch_.TouchMove(slot, pos);
-    it->second = pos;
-    spdlog::debug("Touch move at slot {} position ({}, {})", slot, pos.x,
-                  pos.y);
+    StorePos(slot, pos);
 }
 
 void TouchController::TouchTap(cv::Point pos, int duration_ms) {
     int slot = TouchDown(pos);
     if (slot != -1) {
-        std::this_thread::sleep_for(std::chrono::milliseconds(duration_ms));
+        SleepForMs(duration_ms);
         TouchUp(slot);
     }
 }
 
+uint64_t TouchController::PackPos(cv::Point pos) {
+    return (uint64_t{static_cast<uint32_t>(pos.x)} << 32) |
+           static_cast<uint32_t>(pos.y);
+}
+
+cv::Point TouchController::UnpackPos(uint64_t packed) {
+    return cv::Point{static_cast<int32_t>(packed >> 32),
+                     static_cast<int32_t>(packed & 0xffffffff)};
+}
+
+int TouchController::AcquireSlot() {
+    uint32_t mask = free_mask_.load(std::memory_order_relaxed);
+    while (mask != 0) {
+        // released slots are reused last, like a queue
+        int slot = next_slot_.load(std::memory_order_relaxed);
+        while (((mask >> slot) & 1) == 0) {
+            slot = (slot + 1) % kMaxSlots;
+        }
+        if (free_mask_.compare_exchange_weak(mask, mask & ~(1u << slot),
+                                             std::memory_order_acquire,
+                                             std::memory_order_relaxed)) {
+            next_slot_.store((slot + 1) % kMaxSlots,
+                             std::memory_order_relaxed);
+            return slot;
+        }
+    }
+    return -1;
+}
+
+bool TouchController::CheckSlotInUse(int slot) const {
+    if (slot < 0 || slot >= kMaxSlots || ((supported_mask_ >> slot) & 1) == 0) {
+        spdlog::warn("Slot {} is not supported", slot);
+        return false;
+    }
+    uint32_t released =
+        free_mask_.load(std::memory_order_acquire) | released_in_frame_;
+    if ((released >> slot) & 1) {
+        spdlog::warn("Slot {} is not in use", slot);
+        return false;
+    }
+    return true;
+}
+
+void TouchController::StorePos(int slot, cv::Point pos) {
+    uint32_t seq = seq_.load(std::memory_order_relaxed);
+    seq_.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot_pos_[slot].store(PackPos(pos), std::memory_order_relaxed);
+    seq_.store(seq + 2, std::memory_order_release);
+}
+
 } // namespace psh
\ No newline at end of file
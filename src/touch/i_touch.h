@@ -3,26 +3,41 @@
 #ifndef PSH_TOUCH_I_TOUCH_H_
 #define PSH_TOUCH_I_TOUCH_H_
 
+#include <array>
 #include <atomic>
 #include <condition_variable>
+#include <cstdint>
 #include <memory>
-#include <queue>
 #include <mutex>
 #include <thread>
 #include <vector>
-#include <unordered_set>
 #include <unordered_map>
 
 #include <opencv2/opencv.hpp>
 
+#include "touch/touch_scheduler.h"
+
 namespace psh {
 
 enum class TouchAction { Down, Up, Move };
 
+// When all slots are busy a new tap or hold takes the slot of a parked
+// contact. That contact is lifted meanwhile and pressed again once a slot is
+// free. Taps and holds are never lifted, a new contact is dropped instead.
+enum class TouchPriority { kParked, kHold, kTap };
+
 struct TouchTask {
     TouchAction action;
     cv::Point pos;
     int64_t execute_time_ns;
+    // Move tasks with a duration glide from `from` to pos along a cubic
+    // spline, positions are evaluated when the task is dispatched
+    int64_t duration_ns = 0;
+    cv::Point from{};
+    float slope_in = 1.0f;
+    float slope_out = 1.0f;
+
+    cv::Point GetPosAt(int64_t elapsed_ns) const;
 };
 
 class ITouch {
@@ -32,10 +47,59 @@ public:
     virtual void TouchUp(int slot_id) = 0;
     virtual void TouchMove(int slot_id, cv::Point pos) = 0;
     virtual const std::vector<int>& GetSupportedSlots() const = 0;
+
+    // Actions between BeginFrame and CommitFrame may be buffered and applied
+    // together as one input frame. By default every action applies at once.
+    virtual void BeginFrame() {}
+    virtual void CommitFrame() {}
+};
+
+// clang-format off
+struct TouchThreadConfig {
+    int spin_us   = 0;      // spin this long before a due task, 0 only sleeps
+    int batch_us  = 0;      // tasks due within this window share a frame
+    int motion_us = 1000;   // interval between positions of a motion
+    bool realtime = false;  // real-time priority for the touch thread
+    int cpu       = -1;     // cpu to pin the touch thread to, -1 for any
+};
+// clang-format on
+
+// Contacts the executor gave up on, the lateness of dispatched tasks is
+// kept by DispatchRecorder.
+struct DispatchStats {
+    uint64_t preempted = 0; // contacts lifted for a higher priority one
+    uint64_t dropped = 0;   // streams dropped for lack of a slot
 };
 
 class TouchExecutor;
 class TouchController;
+class TouchTaskStream;
+class DispatchRecorder;
+
+// Refers to a stream passed to TouchExecutor::Execute. The stream can be
+// moved or cancelled until its first task ran. Must not outlive the executor.
+class TouchHandle {
+public:
+    TouchHandle() = default;
+
+    // first task is not executed yet and the stream is not cancelled
+    bool IsPending() const;
+    int64_t GetExecuteTimeMs() const;
+    // Shifts the whole stream so that its first task runs at
+    // execute_time_ms. Returns false once the stream started.
+    bool Reschedule(int64_t execute_time_ms);
+    bool Cancel();
+
+private:
+    friend class TouchExecutor;
+
+    TouchHandle(TouchExecutor* executor,
+                const std::shared_ptr<TouchTaskStream>& stream)
+        : executor_(executor), stream_(stream) {}
+
+    TouchExecutor* executor_ = nullptr;
+    std::weak_ptr<TouchTaskStream> stream_;
+};
 
 class TouchTaskStream {
 public:
@@ -48,22 +112,38 @@ public:
 
     bool Empty() const { return tasks_.empty(); }
     const TouchTask& GetCurrent() const { return tasks_[cur_index_]; }
+    const std::vector<TouchTask>& GetTasks() const { return tasks_; }
+    TouchPriority GetPriority() const { return priority_; }
 
     void AddTask(int64_t execute_time_ms, TouchAction action, cv::Point pos);
     void AddTap(int64_t execute_time_ms, cv::Point pos, int duration_ms = 20);
+    void AddMotion(int64_t execute_time_ms, cv::Point from, cv::Point to,
+                   int duration_ms, double slope_in = 1, double slope_out = 1);
     void AddSlide(int64_t execute_time_ms, cv::Point from, cv::Point to,
-                  int duration_ms = 100, int step_delay_ms = 5,
-                  double slope_in = 1, double slope_out = 1,
-                  bool touch_down = true, bool touch_up = true);
+                  int duration_ms = 100, double slope_in = 1,
+                  double slope_out = 1, bool touch_down = true,
+                  bool touch_up = true);
+    void SetPriority(TouchPriority priority) { priority_ = priority; }
 
 private:
     friend class TouchExecutor;
+    friend class TouchTaskStreamPool;
 
     bool HasNext() { return cur_index_ < tasks_.size(); }
-    void Next() { ++cur_index_; }
+    void Next() {
+        ++cur_index_;
+        motion_offset_ns_ = 0;
+    }
+    int64_t GetNextTimeNs() const {
+        return GetCurrent().execute_time_ns + motion_offset_ns_;
+    }
 
     int cur_index_ = 0;
-    int slot_index_ = -1;
+    int64_t motion_offset_ns_ = 0; // next position of the current motion
+    int contact_id_ = -1;
+    TouchPriority priority_ = TouchPriority::kTap;
+    uint32_t version_ = 0;
+    bool cancelled_ = false;
     std::vector<TouchTask> tasks_;
 };
 
@@ -72,58 +152,97 @@ public:
     virtual ~TouchExecutor();
 
     void SetBaseTime(int64_t base_time_ms);
+    // takes effect on the next Start
+    void SetThreadConfig(const TouchThreadConfig& config);
+    DispatchStats GetDispatchStats();
+    // every dispatched task is recorded with its ITouch call time
+    void SetRecorder(std::shared_ptr<DispatchRecorder> recorder);
 
     bool Start();
     void Shutdown(bool force);
     void Stop();
 
-    void Execute(std::unique_ptr<TouchTaskStream> task_stream);
-    void Execute(const TouchTaskStream& task_stream);
-    void Execute(TouchTaskStream&& task_stream);
+    TouchHandle Execute(std::unique_ptr<TouchTaskStream> task_stream);
+    TouchHandle Execute(const TouchTaskStream& task_stream);
+    TouchHandle Execute(TouchTaskStream&& task_stream);
 
-    void TouchTap(int64_t execute_time_ms, cv::Point pos, int duration_ms = 20);
-    void TouchSlide(int64_t execute_time_ms, cv::Point from, cv::Point to,
-                    int duration_ms = 100, int step_delay_ms = 5,
-                    double slope_in = 1, double slope_out = 1);
+    TouchHandle TouchTap(int64_t execute_time_ms, cv::Point pos,
+                         int duration_ms = 20);
+    TouchHandle TouchSlide(int64_t execute_time_ms, cv::Point from,
+                           cv::Point to, int duration_ms = 100,
+                           double slope_in = 1, double slope_out = 1);
 
 private:
     friend class TouchController;
+    friend class TouchHandle;
 
     static const int kStop = 0;
     static const int kShutdown = 1;
     static const int kRun = 2;
+    static const size_t kStreamPoolSize = 64;
+
+    struct Contact {
+        int slot; // -1 while lifted for a higher priority contact
+        cv::Point pos;
+        TouchPriority priority;
+    };
 
-    TouchExecutor(TouchController& touch) : touch_(touch) {}
-    int64_t GetExecuteTime(const TouchTaskStream& task) const;
+    TouchExecutor(TouchController& touch, TouchSchedulerType scheduler)
+        : touch_(touch),
+          stream_pool_(kStreamPoolSize),
+          touch_tasks_(ITouchScheduler::Create(scheduler)) {}
+    int64_t GetExecuteTime(const ScheduledStream& entry) const;
+    static bool IsStale(const ScheduledStream& entry);
+    TouchHandle Submit(std::shared_ptr<TouchTaskStream> task_stream);
+    void Schedule(std::shared_ptr<TouchTaskStream> task_stream);
     void ProcessTouch(TouchTaskStream& task_stream, int64_t cur_time_ns);
     void ProcessTouchTasksLoop();
+    void ConfigureThread();
+
+    // returns the contact id, -1 if no slot could be freed
+    int PressContact(cv::Point pos, TouchPriority priority);
+    // false when nothing was sent, the contact is already at pos
+    bool MoveContact(int contact_id, cv::Point pos);
+    void ReleaseContact(int contact_id);
+    bool PreemptContact(TouchPriority priority);
+    void ResumeContact();
+
+    bool IsPending(const TouchTaskStream& task_stream);
+    int64_t GetExecuteTimeMs(const TouchTaskStream& task_stream);
+    bool Reschedule(const std::shared_ptr<TouchTaskStream>& task_stream,
+                    int64_t execute_time_ms);
+    bool Cancel(TouchTaskStream& task_stream);
 
     TouchController& touch_;
 
-    struct TouchTaskStreamComp {
-        bool operator()(const std::shared_ptr<TouchTaskStream>& lhs,
-                        const std::shared_ptr<TouchTaskStream>& rhs) const {
-            return lhs->GetCurrent().execute_time_ns >
-                   rhs->GetCurrent().execute_time_ns;
-        }
-    };
-
-    std::priority_queue<std::shared_ptr<TouchTaskStream>,
-                        std::vector<std::shared_ptr<TouchTaskStream>>,
-                        TouchTaskStreamComp>
-        touch_tasks_;
+    // declared first, streams return to the pool when the scheduler clears
+    TouchTaskStreamPool stream_pool_;
+    std::unique_ptr<ITouchScheduler> touch_tasks_;
 
     std::mutex mutex_;
     std::condition_variable cv_;
     std::atomic_int run_flag_ = kStop;
     std::thread touch_thread_;
-    std::unordered_set<int> slots_;
+    std::unordered_map<int, Contact> contacts_;
+    int next_contact_id_ = 0;
 
     int64_t base_time_ns_ = 0;
+    TouchThreadConfig thread_config_;
+    DispatchStats dispatch_stats_;
+    std::shared_ptr<DispatchRecorder> recorder_;
 };
 
+// Slots are tracked in a fixed table indexed by slot id. Acquiring a slot
+// is lock free, releasing it and the ITouch calls are serialized by a mutex
+// only the touching threads take. Readers of the touch points never block
+// the writers, they retry on a sequence lock instead.
+// A slot lifted inside a frame is only freed when the frame is committed,
+// so one frame never lifts and presses the same slot. A press that finds no
+// other slot commits the frame early.
 class TouchController {
 public:
+    static constexpr int kMaxSlots = 32;
+
     TouchController(ITouch& touch);
     virtual ~TouchController() {}
 
@@ -131,8 +250,11 @@ public:
     void TouchUp(int slot);
     void TouchMove(int slot, cv::Point pos);
     void TouchTap(cv::Point pos, int duration_ms = 20);
+    void BeginFrame();
+    void CommitFrame();
 
-    TouchExecutor CreateExecutor();
+    TouchExecutor CreateExecutor(
+        TouchSchedulerType scheduler = TouchSchedulerType::kHeap);
 
     std::vector<cv::Point> GetCurrentTouchPoints();
 
@@ -141,11 +263,26 @@ private:
 
     inline static const cv::Point kUnusedSlotPos = cv::Point{-1, -1};
 
+    static uint64_t PackPos(cv::Point pos);
+    static cv::Point UnpackPos(uint64_t packed);
+
+    int AcquireSlot();
+    // Caller holds touch_mutex_. Slots are only freed with the mutex held,
+    // so a slot found in use stays so until the caller releases it.
+    bool CheckSlotInUse(int slot) const;
+    // caller holds touch_mutex_, which also excludes other seqlock writers
+    void StorePos(int slot, cv::Point pos);
+
     ITouch& touch_;
 
-    std::mutex mutex_;
-    std::queue<int> unused_slots_;
-    std::unordered_map<int, cv::Point> slot_pos_map_;
+    std::mutex touch_mutex_;
+    bool in_frame_ = false;          // guarded by touch_mutex_
+    uint32_t released_in_frame_ = 0; // guarded by touch_mutex_
+    uint32_t supported_mask_ = 0;
+    std::atomic<uint32_t> free_mask_{0};
+    std::atomic<int> next_slot_{0}; // round robin start of the slot search
+    std::atomic<uint32_t> seq_{0};  // odd while a position is written
+    std::array<std::atomic<uint64_t>, kMaxSlots> slot_pos_{};
 };
 
 } // namespace psh
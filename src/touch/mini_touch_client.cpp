@@ -47,7 +47,7 @@ MiniTouchCommand& MiniTouchCommand::C() {
 
 MiniTouchClient::MiniTouchClient(const QString& host, int port,
                                  int screen_height)
-    : screen_height_(screen_height) {
+    : screen_height_(screen_height), frame_(*this) {
     WSADATA wsa_data;
     int ret = WSAStartup(MAKEWORD(2, 2), &wsa_data);
     if (ret != 0) {
@@ -81,22 +81,44 @@ MiniTouchClient::~MiniTouchClient() {
 
 void MiniTouchClient::TouchDown(int slot_index, cv::Point pos) {
     if (slot_index == -1) {
+        return;
+    }
+    if (in_frame_) {
+        frame_.D(slot_index, pos);
+    } else {
         MiniTouchCommand(*this).D(slot_index, pos).C().Send();
     }
 }
 
 void MiniTouchClient::TouchUp(int slot_index) {
-    if (slot_index != -1) {
+    if (slot_index == -1) {
+        return;
+    }
+    if (in_frame_) {
+        frame_.U(slot_index);
+    } else {
         MiniTouchCommand(*this).U(slot_index).C().Send();
     }
 }
 
 void MiniTouchClient::TouchMove(int slot_index, cv::Point pos) {
-    if (slot_index != -1) {
+    if (slot_index == -1) {
+        return;
+    }
+    if (in_frame_) {
+        frame_.M(slot_index, pos);
+    } else {
         MiniTouchCommand(*this).M(slot_index, pos).Send();
     }
 }
 
+void MiniTouchClient::CommitFrame() {
+    in_frame_ = false;
+    if (!frame_.Empty()) {
+        frame_.C().Send();
+    }
+}
+
 void MiniTouchClient::Close() {
     if (sock_ != INVALID_SOCKET) {
         closesocket(sock_);
@@ -24,6 +24,7 @@ public:
     MiniTouchCommand& M(int slot_index, cv::Point pos);
     MiniTouchCommand& C();
     void Send();
+    bool Empty() const { return buffer_.empty(); }
 
 private:
     MiniTouchClient& touch_;
@@ -45,6 +46,9 @@ public:
     const std::vector<int>& GetSupportedSlots() const override {
         return kSupportedSlots;
     }
+    // buffers the actions of a frame and sends them with a single commit
+    void BeginFrame() override { in_frame_ = true; }
+    void CommitFrame() override;
 
     static void StartMiniTouchService(const QString& mumu_path, int adb_port,
                                       int service_port);
@@ -61,6 +65,8 @@ private:
     int sock_ = -1;
     int screen_height_;
     std::mutex send_mutex_;
+    bool in_frame_ = false;
+    MiniTouchCommand frame_;
 };
 
 } // namespace psh
@@ -0,0 +1,39 @@
+#include "touch/recording_touch.h"
+
+#include "common/time_utils.h"
+
+namespace psh {
+
+void RecordingTouch::TouchDown(int slot_index, cv::Point pos) {
+    Record(TouchAction::Down, slot_index, pos);
+}
+
+void RecordingTouch::TouchUp(int slot_index) {
+    Record(TouchAction::Up, slot_index, {});
+}
+
+void RecordingTouch::TouchMove(int slot_index, cv::Point pos) {
+    Record(TouchAction::Move, slot_index, pos);
+}
+
+std::vector<TouchRecord> RecordingTouch::GetRecords() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return records_;
+}
+
+void RecordingTouch::Clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    records_.clear();
+}
+
+void RecordingTouch::Record(TouchAction action, int slot_index,
+                            cv::Point pos) {
+    if (!record_) {
+        return;
+    }
+    int64_t time_ns = GetCurrentTimeNs();
+    std::lock_guard<std::mutex> lock(mutex_);
+    records_.push_back(TouchRecord{time_ns, action, slot_index, pos});
+}
+
+} // namespace psh
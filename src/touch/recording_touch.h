@@ -0,0 +1,52 @@
+#pragma once
+
+#ifndef PSH_TOUCH_RECORDING_TOUCH_H_
+#define PSH_TOUCH_RECORDING_TOUCH_H_
+
+#include <mutex>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include "touch/i_touch.h"
+
+namespace psh {
+
+struct TouchRecord {
+    int64_t time_ns;
+    TouchAction action;
+    int slot;
+    cv::Point pos;
+};
+
+// Touch backend that only records the events it receives, for headless
+// replays and benchmarks.
+class RecordingTouch : public ITouch {
+public:
+    inline static const std::vector<int> kSupportedSlots = {0, 1, 2, 3, 4,
+                                                            5, 6, 7, 8, 9};
+
+    RecordingTouch(bool record = true) : record_(record) {}
+    virtual ~RecordingTouch() = default;
+
+    void TouchDown(int slot_index, cv::Point pos) override;
+    void TouchUp(int slot_index) override;
+    void TouchMove(int slot_index, cv::Point pos) override;
+    const std::vector<int>& GetSupportedSlots() const override {
+        return kSupportedSlots;
+    }
+
+    std::vector<TouchRecord> GetRecords() const;
+    void Clear();
+
+private:
+    void Record(TouchAction action, int slot_index, cv::Point pos);
+
+    bool record_;
+    mutable std::mutex mutex_;
+    std::vector<TouchRecord> records_;
+};
+
+} // namespace psh
+
+#endif // !PSH_TOUCH_RECORDING_TOUCH_H_
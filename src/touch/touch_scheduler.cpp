@@ -0,0 +1,290 @@
+#include "touch/touch_scheduler.h"
+
+#include <algorithm>
+#include <new>
+#include <utility>
+
+#include "touch/i_touch.h"
+
+namespace psh {
+
+std::unique_ptr<ITouchScheduler> ITouchScheduler::Create(
+    TouchSchedulerType type) {
+    switch (type) {
+        case TouchSchedulerType::kTimerWheel:
+            return std::make_unique<TimerWheelTouchScheduler>();
+        case TouchSchedulerType::kHeap:
+        default:
+            return std::make_unique<HeapTouchScheduler>();
+    }
+}
+
+void HeapTouchScheduler::Push(ScheduledStream entry) {
+    queue_.push(std::move(entry));
+}
+
+ScheduledStream HeapTouchScheduler::Pop() {
+    ScheduledStream entry = queue_.top();
+    queue_.pop();
+    return entry;
+}
+
+void HeapTouchScheduler::Clear() {
+    while (!queue_.empty()) {
+        queue_.pop();
+    }
+}
+
+TimerWheelTouchScheduler::TimerWheelTouchScheduler() {
+    for (int level = 0; level < kLevels; ++level) {
+        int bits = level == 0 ? kLevel0Bits : kLevelBits;
+        slots_[level].resize(size_t{1} << bits);
+    }
+    for (auto& slot : slots_[0]) {
+        slot.reserve(kInitialSlotSize);
+    }
+}
+
+void TimerWheelTouchScheduler::Push(ScheduledStream entry) {
+    if (size_ == 0) {
+        cur_tick_ = GetTick(entry.execute_time_ns);
+    }
+    Insert(std::move(entry));
+    ++size_;
+    top_index_ = -1;
+}
+
+const ScheduledStream& TimerWheelTouchScheduler::Top() {
+    int index = FindTop();
+    return GetSlot(0, cur_tick_)[index];
+}
+
+ScheduledStream TimerWheelTouchScheduler::Pop() {
+    int index = FindTop();
+    auto& slot = GetSlot(0, cur_tick_);
+    ScheduledStream entry = std::move(slot[index]);
+    if (index + 1 != static_cast<int>(slot.size())) {
+        slot[index] = std::move(slot.back());
+    }
+    slot.pop_back();
+    --counts_[0];
+    --size_;
+    top_index_ = -1;
+    return entry;
+}
+
+void TimerWheelTouchScheduler::Clear() {
+    for (auto& level : slots_) {
+        for (auto& slot : level) {
+            slot.clear();
+        }
+    }
+    counts_.fill(0);
+    overflow_.clear();
+    size_ = 0;
+    top_index_ = -1;
+}
+
+int64_t TimerWheelTouchScheduler::GetTick(int64_t execute_time_ns) {
+    // floor division, times before the base time are negative
+    constexpr int64_t kNsPerTick = 1'000'000;
+    return execute_time_ns >= 0
+               ? execute_time_ns / kNsPerTick
+               : (execute_time_ns - kNsPerTick + 1) / kNsPerTick;
+}
+
+int TimerWheelTouchScheduler::GetShift(int level) {
+    return level == 0 ? 0 : kLevel0Bits + (level - 1) * kLevelBits;
+}
+
+std::vector<ScheduledStream>& TimerWheelTouchScheduler::GetSlot(int level,
+                                                                int64_t tick) {
+    auto& slots = slots_[level];
+    uint64_t index = static_cast<uint64_t>(tick) >> GetShift(level);
+    return slots[index & (slots.size() - 1)];
+}
+
+void TimerWheelTouchScheduler::Insert(ScheduledStream&& entry) {
+    // entries already due join the current slot, Top compares exact times
+    int64_t tick = std::max(GetTick(entry.execute_time_ns), cur_tick_);
+    int64_t delta = tick - cur_tick_;
+    for (int level = 0; level < kLevels; ++level) {
+        if (delta < GetSpan(level + 1)) {
+            GetSlot(level, tick).push_back(std::move(entry));
+            ++counts_[level];
+            return;
+        }
+    }
+    overflow_.push_back(std::move(entry));
+}
+
+void TimerWheelTouchScheduler::Advance() {
+    // Entries of a level are always past the current slot of that level, so
+    // stepping to the next slot boundary of the lowest non-empty level never
+    // skips an entry. Crossing a boundary pulls the slots of the higher
+    // levels down first.
+    while (true) {
+        if (counts_[0] > 0) {
+            int64_t end = cur_tick_ | (GetSpan(1) - 1);
+            for (; cur_tick_ <= end; ++cur_tick_) {
+                if (!GetSlot(0, cur_tick_).empty()) {
+                    return;
+                }
+            }
+        } else {
+            int level = 1;
+            while (level < kLevels && counts_[level] == 0) {
+                ++level;
+            }
+            if (level == kLevels) {
+                // only far entries are left, restart the wheel at the first
+                int64_t first_tick = GetTick(overflow_.front().execute_time_ns);
+                for (const auto& entry : overflow_) {
+                    first_tick =
+                        std::min(first_tick, GetTick(entry.execute_time_ns));
+                }
+                cur_tick_ = first_tick;
+                Cascade(kLevels);
+                continue;
+            }
+            cur_tick_ = (cur_tick_ | (GetSpan(level) - 1)) + 1;
+        }
+        for (int level = kLevels; level >= 1; --level) {
+            if ((cur_tick_ & (GetSpan(level) - 1)) == 0) {
+                Cascade(level);
+            }
+        }
+    }
+}
+
+void TimerWheelTouchScheduler::Cascade(int level) {
+    if (level == kLevels) {
+        cascade_buffer_.swap(overflow_);
+    } else {
+        auto& slot = GetSlot(level, cur_tick_);
+        counts_[level] -= slot.size();
+        cascade_buffer_.swap(slot);
+    }
+    for (auto& entry : cascade_buffer_) {
+        Insert(std::move(entry));
+    }
+    cascade_buffer_.clear();
+}
+
+int TimerWheelTouchScheduler::FindTop() {
+    if (top_index_ != -1) {
+        return top_index_;
+    }
+    Advance();
+    const auto& slot = GetSlot(0, cur_tick_);
+    top_index_ = 0;
+    for (int i = 1; i < static_cast<int>(slot.size()); ++i) {
+        if (slot[i].execute_time_ns < slot[top_index_].execute_time_ns) {
+            top_index_ = i;
+        }
+    }
+    return top_index_;
+}
+
+template <typename T>
+class TouchTaskStreamPool::BlockAllocator {
+public:
+    using value_type = T;
+
+    explicit BlockAllocator(TouchTaskStreamPool* pool) : pool_(pool) {}
+    template <typename U>
+    BlockAllocator(const BlockAllocator<U>& other) : pool_(other.pool_) {}
+
+    T* allocate(size_t n) {
+        return static_cast<T*>(pool_->AllocateBlock(n * sizeof(T)));
+    }
+    void deallocate(T* p, size_t n) { pool_->FreeBlock(p, n * sizeof(T)); }
+
+    template <typename U>
+    bool operator==(const BlockAllocator<U>& other) const {
+        return pool_ == other.pool_;
+    }
+    template <typename U>
+    bool operator!=(const BlockAllocator<U>& other) const {
+        return pool_ != other.pool_;
+    }
+
+private:
+    template <typename U>
+    friend class BlockAllocator;
+
+    TouchTaskStreamPool* pool_;
+};
+
+TouchTaskStreamPool::TouchTaskStreamPool(size_t capacity) {
+    streams_.reserve(capacity);
+    free_streams_.reserve(capacity);
+    free_blocks_.reserve(capacity);
+    for (size_t i = 0; i < capacity; ++i) {
+        streams_.push_back(std::make_unique<TouchTaskStream>());
+        streams_.back()->tasks_.reserve(kTaskCount);
+        free_streams_.push_back(streams_.back().get());
+        free_blocks_.push_back(::operator new(kBlockSize));
+    }
+}
+
+TouchTaskStreamPool::~TouchTaskStreamPool() {
+    for (void* block : free_blocks_) {
+        ::operator delete(block);
+    }
+}
+
+std::shared_ptr<TouchTaskStream> TouchTaskStreamPool::Acquire() {
+    TouchTaskStream* stream;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (free_streams_.empty()) {
+            streams_.push_back(std::make_unique<TouchTaskStream>());
+            streams_.back()->tasks_.reserve(kTaskCount);
+            stream = streams_.back().get();
+        } else {
+            stream = free_streams_.back();
+            free_streams_.pop_back();
+        }
+    }
+    return std::shared_ptr<TouchTaskStream>(
+        stream, [this](TouchTaskStream* stream) { Release(stream); },
+        BlockAllocator<TouchTaskStream>(this));
+}
+
+void* TouchTaskStreamPool::AllocateBlock(size_t size) {
+    if (size > kBlockSize) {
+        return ::operator new(size);
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (free_blocks_.empty()) {
+        return ::operator new(kBlockSize);
+    }
+    void* block = free_blocks_.back();
+    free_blocks_.pop_back();
+    return block;
+}
+
+void TouchTaskStreamPool::FreeBlock(void* block, size_t size) {
+    if (size > kBlockSize) {
+        ::operator delete(block);
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    free_blocks_.push_back(block);
+}
+
+void TouchTaskStreamPool::Release(TouchTaskStream* stream) {
+    // keeps the task capacity for the next stream
+    stream->tasks_.clear();
+    stream->cur_index_ = 0;
+    stream->motion_offset_ns_ = 0;
+    stream->contact_id_ = -1;
+    stream->priority_ = TouchPriority::kTap;
+    stream->version_ = 0;
+    stream->cancelled_ = false;
+    std::lock_guard<std::mutex> lock(mutex_);
+    free_streams_.push_back(stream);
+}
+
+} // namespace psh
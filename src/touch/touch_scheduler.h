@@ -0,0 +1,141 @@
+#pragma once
+
+#ifndef PSH_TOUCH_TOUCH_SCHEDULER_H_
+#define PSH_TOUCH_TOUCH_SCHEDULER_H_
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <vector>
+
+namespace psh {
+
+class TouchTaskStream;
+
+// Queue entry of a stream. Rescheduling pushes a new entry with the next
+// version, entries with an old version or of cancelled streams are dropped
+// when they reach the top.
+struct ScheduledStream {
+    int64_t execute_time_ns;
+    uint32_t version;
+    std::shared_ptr<TouchTaskStream> stream;
+};
+
+enum class TouchSchedulerType { kHeap, kTimerWheel };
+
+// Orders the scheduled streams of a TouchExecutor by execute time.
+class ITouchScheduler {
+public:
+    virtual ~ITouchScheduler() {}
+
+    virtual bool Empty() const = 0;
+    virtual void Push(ScheduledStream entry) = 0;
+    // earliest entry, the scheduler must not be empty
+    virtual const ScheduledStream& Top() = 0;
+    virtual ScheduledStream Pop() = 0;
+    virtual void Clear() = 0;
+
+    static std::unique_ptr<ITouchScheduler> Create(TouchSchedulerType type);
+};
+
+class HeapTouchScheduler : public ITouchScheduler {
+public:
+    bool Empty() const override { return queue_.empty(); }
+    void Push(ScheduledStream entry) override;
+    const ScheduledStream& Top() override { return queue_.top(); }
+    ScheduledStream Pop() override;
+    void Clear() override;
+
+private:
+    struct ScheduledStreamComp {
+        bool operator()(const ScheduledStream& lhs,
+                        const ScheduledStream& rhs) const {
+            return lhs.execute_time_ns > rhs.execute_time_ns;
+        }
+    };
+
+    std::priority_queue<ScheduledStream, std::vector<ScheduledStream>,
+                        ScheduledStreamComp>
+        queue_;
+};
+
+// Hierarchical timer wheel with 1 ms ticks. Level 0 holds the next 256
+// ticks, every higher level has 64 slots each spanning a whole lower level
+// and entries beyond the last level wait in an overflow list. Slots keep
+// their capacity when emptied, so a warmed up wheel does not allocate.
+class TimerWheelTouchScheduler : public ITouchScheduler {
+public:
+    // clang-format off
+    static constexpr int kLevels          = 4;
+    static constexpr int kLevel0Bits      = 8;
+    static constexpr int kLevelBits       = 6;
+    static constexpr int kInitialSlotSize = 4;
+    // clang-format on
+
+    TimerWheelTouchScheduler();
+
+    bool Empty() const override { return size_ == 0; }
+    void Push(ScheduledStream entry) override;
+    const ScheduledStream& Top() override;
+    ScheduledStream Pop() override;
+    void Clear() override;
+
+private:
+    static int64_t GetTick(int64_t execute_time_ns);
+    // log2 of the ticks spanned by one slot of the level, level kLevels
+    // spans the whole wheel
+    static int GetShift(int level);
+    static int64_t GetSpan(int level) { return int64_t{1} << GetShift(level); }
+
+    std::vector<ScheduledStream>& GetSlot(int level, int64_t tick);
+    void Insert(ScheduledStream&& entry);
+    void Advance();
+    void Cascade(int level);
+    int FindTop();
+
+    std::array<std::vector<std::vector<ScheduledStream>>, kLevels> slots_;
+    std::array<size_t, kLevels> counts_{};
+    std::vector<ScheduledStream> overflow_;
+    std::vector<ScheduledStream> cascade_buffer_;
+    int64_t cur_tick_ = 0;
+    size_t size_ = 0;
+    int top_index_ = -1; // in the current level 0 slot, -1 when unknown
+};
+
+// Hands out task streams whose storage is recycled once the last reference
+// is released. Control blocks come from a free list as well, so scheduling
+// from a warmed up pool does not allocate. Must outlive every stream and
+// TouchHandle created from it.
+class TouchTaskStreamPool {
+public:
+    // clang-format off
+    static constexpr size_t kBlockSize  = 64;
+    static constexpr size_t kTaskCount  = 32;   // tasks reserved per stream
+    // clang-format on
+
+    explicit TouchTaskStreamPool(size_t capacity = 0);
+    ~TouchTaskStreamPool();
+    TouchTaskStreamPool(const TouchTaskStreamPool&) = delete;
+    TouchTaskStreamPool& operator=(const TouchTaskStreamPool&) = delete;
+
+    std::shared_ptr<TouchTaskStream> Acquire();
+
+private:
+    template <typename T>
+    class BlockAllocator;
+
+    void* AllocateBlock(size_t size);
+    void FreeBlock(void* block, size_t size);
+    void Release(TouchTaskStream* stream);
+
+    std::mutex mutex_;
+    std::vector<std::unique_ptr<TouchTaskStream>> streams_;
+    std::vector<TouchTaskStream*> free_streams_;
+    std::vector<void*> free_blocks_;
+};
+
+} // namespace psh
+
+#endif // !PSH_TOUCH_TOUCH_SCHEDULER_H_
@@ -143,13 +143,42 @@ void MainWindow::LoadSettings() {
     sample_freq_spin_->setValue(
         settings.value("play/sample_freq", 1000 / pc.check_loop_delay_ms)
             .toInt());
+    detect_threads_spin_->setValue(
+        settings.value("play/detect_threads", pc.detect_threads).toInt());
+    touch_spin_spin_->setValue(
+        settings.value("play/touch_spin_us", pc.touch_thread.spin_us).toInt());
+    touch_batch_spin_->setValue(
+        settings.value("play/touch_batch_us", pc.touch_thread.batch_us)
+            .toInt());
+    touch_cpu_spin_->setValue(
+        settings.value("play/touch_cpu", pc.touch_thread.cpu).toInt());
 
     img_show_checkbox_->setChecked(false);
     sus_mode_checkbox_->setChecked(
         settings.value("play/sus_mode", pc.sus_mode).toBool());
+    async_capture_checkbox_->setChecked(
+        settings.value("play/async_capture", pc.async_capture).toBool());
+    record_session_checkbox_->setChecked(
+        settings.value("play/record_session", pc.record_session).toBool());
+    incremental_scan_checkbox_->setChecked(
+        settings.value("play/incremental_scan", pc.incremental_scan).toBool());
+    timer_wheel_checkbox_->setChecked(
+        settings
+            .value("play/timer_wheel",
+                   pc.scheduler == TouchSchedulerType::kTimerWheel)
+            .toBool());
+    touch_realtime_checkbox_->setChecked(
+        settings.value("play/touch_realtime", pc.touch_thread.realtime)
+            .toBool());
+    export_dispatch_checkbox_->setChecked(
+        settings.value("play/export_dispatch", pc.export_dispatch).toBool());
     speed_factor_combo_->setCurrentText(
         settings.value("play/speed_factor", "10.00").toString());
     play_mode_combo_->setCurrentIndex(settings.value("play/mode", 0).toInt());
+    record_region_combo_->setCurrentIndex(
+        settings
+            .value("play/record_region", static_cast<int>(pc.record_region))
+            .toInt());
 
     multi_mode_combo_->setCurrentIndex(settings.value("multi/mode", 0).toInt());
     multi_max_diff_combo_->setCurrentIndex(
@@ -165,9 +194,26 @@ void MainWindow::SaveSettings() {
     settings.setValue("play/cv_hit_delay", cv_hit_delay_spin_->value());
     settings.setValue("play/sus_hit_delay", sus_hit_delay_spin_->value());
     settings.setValue("play/sample_freq", sample_freq_spin_->value());
+    settings.setValue("play/detect_threads", detect_threads_spin_->value());
+    settings.setValue("play/touch_spin_us", touch_spin_spin_->value());
+    settings.setValue("play/touch_batch_us", touch_batch_spin_->value());
+    settings.setValue("play/touch_cpu", touch_cpu_spin_->value());
     settings.setValue("play/speed_factor", speed_factor_combo_->currentText());
     settings.setValue("play/sus_mode", sus_mode_checkbox_->isChecked());
+    settings.setValue("play/async_capture",
+                      async_capture_checkbox_->isChecked());
+    settings.setValue("play/record_session",
+                      record_session_checkbox_->isChecked());
+    settings.setValue("play/incremental_scan",
+                      incremental_scan_checkbox_->isChecked());
+    settings.setValue("play/timer_wheel", timer_wheel_checkbox_->isChecked());
+    settings.setValue("play/touch_realtime",
+                      touch_realtime_checkbox_->isChecked());
+    settings.setValue("play/export_dispatch",
+                      export_dispatch_checkbox_->isChecked());
     settings.setValue("play/mode", play_mode_combo_->currentIndex());
+    settings.setValue("play/record_region",
+                      record_region_combo_->currentIndex());
 
     settings.setValue("multi/mode", multi_mode_combo_->currentIndex());
     settings.setValue("multi/max_diff", multi_max_diff_combo_->currentIndex());
@@ -226,6 +272,23 @@ void MainWindow::SetupUi() {
     sample_freq_spin_->setValue(50);
     config_layout->addRow("检查频率(Hz)：", sample_freq_spin_);
 
+    detect_threads_spin_ = new QSpinBox(this);
+    detect_threads_spin_->setRange(1, 16);
+    config_layout->addRow("识别线程数：", detect_threads_spin_);
+
+    touch_spin_spin_ = new QSpinBox(this);
+    touch_spin_spin_->setRange(0, 5000);
+    config_layout->addRow("触摸自旋等待(us)：", touch_spin_spin_);
+
+    touch_batch_spin_ = new QSpinBox(this);
+    touch_batch_spin_->setRange(0, 5000);
+    config_layout->addRow("触摸合并窗口(us)：", touch_batch_spin_);
+
+    touch_cpu_spin_ = new QSpinBox(this);
+    touch_cpu_spin_->setRange(-1, 63);
+    touch_cpu_spin_->setSpecialValueText("不绑定");
+    config_layout->addRow("触摸线程核心：", touch_cpu_spin_);
+
     speed_factor_combo_ = new QComboBox(this);
     speed_factor_combo_->addItems({"6.00", "8.00", "9.00", "10.00", "11.00"});
     config_layout->addRow("流速：", speed_factor_combo_);
@@ -234,10 +297,27 @@ void MainWindow::SetupUi() {
     play_mode_combo_->addItems({"单次", "单人模式", "协力模式"});
     config_layout->addRow("游戏模式：", play_mode_combo_);
 
+    // same order as RecordRegion
+    record_region_combo_ = new QComboBox(this);
+    record_region_combo_->addItems({"判定区域", "轨道区域", "全屏"});
+    config_layout->addRow("录制范围：", record_region_combo_);
+
     auto config_checkbox_layout = new QHBoxLayout();
     sus_mode_checkbox_ = new QCheckBox("启用 SUS 模式", this);
     img_show_checkbox_ = new QCheckBox("显示画面", this);
+    async_capture_checkbox_ = new QCheckBox("异步截图", this);
+    record_session_checkbox_ = new QCheckBox("录制画面", this);
+    incremental_scan_checkbox_ = new QCheckBox("增量识别", this);
+    timer_wheel_checkbox_ = new QCheckBox("时间轮调度", this);
+    touch_realtime_checkbox_ = new QCheckBox("触摸实时优先级", this);
+    export_dispatch_checkbox_ = new QCheckBox("导出触摸延迟", this);
     config_checkbox_layout->addWidget(sus_mode_checkbox_);
+    config_checkbox_layout->addWidget(async_capture_checkbox_);
+    config_checkbox_layout->addWidget(record_session_checkbox_);
+    config_checkbox_layout->addWidget(incremental_scan_checkbox_);
+    config_checkbox_layout->addWidget(timer_wheel_checkbox_);
+    config_checkbox_layout->addWidget(touch_realtime_checkbox_);
+    config_checkbox_layout->addWidget(export_dispatch_checkbox_);
     config_checkbox_layout->addWidget(img_show_checkbox_);
     config_checkbox_layout->addStretch();
     config_layout->addRow(config_checkbox_layout);
@@ -415,10 +495,24 @@ PlayConfig MainWindow::GetPlayConfig() const {
     PlayConfig pc{};
     pc.hold_cnt = 6;
     pc.check_loop_delay_ms = 1000 / sample_freq_spin_->value();
+    pc.detect_threads = detect_threads_spin_->value();
     pc.cv_hit_delay_ms = cv_hit_delay_spin_->value();
     pc.sus_hit_delay_ms = sus_hit_delay_spin_->value();
     pc.speed_factor = GetCurrentSpeedFactor();
     pc.sus_mode = sus_mode_checkbox_->isChecked();
+    pc.async_capture = async_capture_checkbox_->isChecked();
+    pc.record_session = record_session_checkbox_->isChecked();
+    pc.record_region =
+        static_cast<RecordRegion>(record_region_combo_->currentIndex());
+    pc.incremental_scan = incremental_scan_checkbox_->isChecked();
+    pc.scheduler = timer_wheel_checkbox_->isChecked()
+                       ? TouchSchedulerType::kTimerWheel
+                       : TouchSchedulerType::kHeap;
+    pc.touch_thread.spin_us = touch_spin_spin_->value();
+    pc.touch_thread.batch_us = touch_batch_spin_->value();
+    pc.touch_thread.realtime = touch_realtime_checkbox_->isChecked();
+    pc.touch_thread.cpu = touch_cpu_spin_->value();
+    pc.export_dispatch = export_dispatch_checkbox_->isChecked();
     pc.auto_select = multi_mode_combo_->currentIndex() == 1;
 
     switch (multi_max_diff_combo_->currentIndex()) {
@@ -80,10 +80,21 @@ private:
     QSpinBox *cv_hit_delay_spin_;
     QSpinBox *sus_hit_delay_spin_;
     QSpinBox *sample_freq_spin_;
+    QSpinBox *detect_threads_spin_;
+    QSpinBox *touch_spin_spin_;
+    QSpinBox *touch_batch_spin_;
+    QSpinBox *touch_cpu_spin_;
     QComboBox *speed_factor_combo_;
     QComboBox *play_mode_combo_;
+    QComboBox *record_region_combo_;
     QCheckBox *img_show_checkbox_;
     QCheckBox *sus_mode_checkbox_;
+    QCheckBox *async_capture_checkbox_;
+    QCheckBox *record_session_checkbox_;
+    QCheckBox *incremental_scan_checkbox_;
+    QCheckBox *timer_wheel_checkbox_;
+    QCheckBox *touch_realtime_checkbox_;
+    QCheckBox *export_dispatch_checkbox_;
     QPushButton *start_button_;
     QPushButton *stop_button_;
 